@@ -36,6 +36,13 @@ int BufDiskWorker::registerBuffer(sample_t *data, size_t frames) {
   int n = numBufs++;
   bufs[n].data = data;
   bufs[n].frames = frames;
+  bufs[n].loop = nullptr;
+  return n;
+}
+
+int BufDiskWorker::registerBuffer(LoopBuffer &buf) {
+  int n = registerBuffer(buf.data(), buf.frames());
+  bufs[n].loop = &buf;
   return n;
 }
 
@@ -103,6 +110,18 @@ void BufDiskWorker::requestWriteStereo(size_t idx0, size_t idx1,
   requestJob(job);
 }
 
+void BufDiskWorker::requestBuildMips(size_t idx) {
+  BufDiskWorker::Job job{
+      BufDiskWorker::JobType::BuildMips, {idx, 0}, "", 0, 0, 0, 0};
+  requestJob(job);
+}
+
+void BufDiskWorker::requestPrefault(size_t idx, float start, float dur) {
+  BufDiskWorker::Job job{
+      BufDiskWorker::JobType::Prefault, {idx, 0}, "", 0, start, dur, 0};
+  requestJob(job);
+}
+
 void BufDiskWorker::workLoop() {
   while (!shouldQuit) {
     // FIXME: use condvar to wait here instead of sleeping...
@@ -131,6 +150,14 @@ void BufDiskWorker::workLoop() {
           writeBufferStereo(job.path, bufs[job.bufIdx[0]], bufs[job.bufIdx[1]],
                             job.startSrc, job.dur);
           break;
+        case JobType::BuildMips:
+          if (bufs[job.bufIdx[0]].loop != nullptr) {
+            bufs[job.bufIdx[0]].loop->enableMips();
+          }
+          break;
+        case JobType::Prefault:
+          prefaultBuffer(bufs[job.bufIdx[0]], job.startDst, job.dur);
+          break;
       }
 #if 0  // debug, timing
 	    auto ms_now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
@@ -171,11 +198,33 @@ void BufDiskWorker::clearBuffer(BufDesc &buf, float start, float dur) {
     frB = frA + secToFrame(dur);
   }
   clamp(frB, buf.frames);
+  if (buf.loop != nullptr) {
+    buf.loop->clear(frA, frB > frA ? frB - frA : 0);
+    updateMips(buf, frA, frB > frA ? frB - frA : 0);
+    return;
+  }
   for (size_t i = frA; i < frB; ++i) {
     buf.data[i] = 0.f;
   }
 }
 
+void BufDiskWorker::prefaultBuffer(BufDesc &buf, float start, float dur) {
+  if (buf.loop == nullptr) {
+    return;
+  }
+  size_t frA = secToFrame(start);
+  clamp(frA, buf.frames - 1);
+  size_t frB = frA + secToFrame(dur);
+  clamp(frB, buf.frames);
+  buf.loop->prefault(frA, frB > frA ? frB - frA : 0);
+}
+
+void BufDiskWorker::updateMips(BufDesc &buf, size_t start, size_t numFrames) {
+  if (buf.loop != nullptr) {
+    buf.loop->updateMips(start, numFrames);
+  }
+}
+
 void BufDiskWorker::readBufferMono(const std::string &path, BufDesc &buf,
                                    float startSrc, float startDst, float dur,
                                    int chanSrc) noexcept {
@@ -194,6 +243,7 @@ void BufDiskWorker::readBufferMono(const std::string &path, BufDesc &buf,
 
   size_t frDst = secToFrame(startDst);
   clamp(frDst, bufFrames - 1);
+  const size_t frDstStart = frDst;
 
   size_t frDur;
   if (dur < 0.f) {
@@ -244,6 +294,7 @@ void BufDiskWorker::readBufferMono(const std::string &path, BufDesc &buf,
   std::cout << "SoftCutClient::readBufferMono(): done; read " << frDur
             << " frames" << std::endl;
 cleanup:
+  updateMips(buf, frDstStart, frDst - frDstStart);
   delete[] ioBuf;
 }
 
@@ -265,6 +316,7 @@ void BufDiskWorker::readBufferStereo(const std::string &path, BufDesc &buf0,
 
   size_t frDst = secToFrame(startTimeDst);
   clamp(frDst, bufFrames - 1);
+  const size_t frDstStart = frDst;
 
   size_t frDur;
   if (dur < 0.f) {
@@ -296,6 +348,8 @@ void BufDiskWorker::readBufferStereo(const std::string &path, BufDesc &buf0,
     if (res == -1) {
       std::cerr << "error seeking to frame: " << frSrc << "; aborting read"
                 << std::endl;
+      updateMips(buf0, frDstStart, frDst - frDstStart);
+      updateMips(buf1, frDstStart, frDst - frDstStart);
       return;
     }
     file.readf(ioBuf, ioBufFrames);
@@ -314,6 +368,8 @@ void BufDiskWorker::readBufferStereo(const std::string &path, BufDesc &buf0,
     if (res == -1) {
       std::cerr << "error seeking to frame: " << frSrc << "; aborting read"
                 << std::endl;
+      updateMips(buf0, frDstStart, frDst - frDstStart);
+      updateMips(buf1, frDstStart, frDst - frDstStart);
       return;
     }
     file.read(ioBuf, numSrcChan);
@@ -324,6 +380,8 @@ void BufDiskWorker::readBufferStereo(const std::string &path, BufDesc &buf0,
   }
   // std::cout << "SoftCutClient::readBufferStereo(): done; read " << frDur << "
   // frames" << std::endl;
+  updateMips(buf0, frDstStart, frDst - frDstStart);
+  updateMips(buf1, frDstStart, frDst - frDstStart);
   delete[] ioBuf;
 }
 
@@ -23,6 +23,7 @@
 #include <queue>
 #include <thread>
 
+#include "LoopBuffer.h"
 #include "softcut/Types.h"
 using namespace softcut;
 
@@ -30,7 +31,15 @@ namespace softcut_jack_osc {
 
 // class for asynchronous management of mono audio buffers
 class BufDiskWorker {
-  enum class JobType { Clear, ReadMono, ReadStereo, WriteMono, WriteStereo };
+  enum class JobType {
+    Clear,
+    ReadMono,
+    ReadStereo,
+    WriteMono,
+    WriteStereo,
+    BuildMips,
+    Prefault
+  };
   struct Job {
     JobType type;
     size_t bufIdx[2];
@@ -43,6 +52,7 @@ class BufDiskWorker {
   struct BufDesc {
     sample_t *data;
     size_t frames;
+    LoopBuffer *loop;  // backing storage, if registered as a LoopBuffer
   };
   static std::queue<Job> jobQ;
   static std::mutex qMut;
@@ -67,6 +77,8 @@ class BufDiskWorker {
   // register a buffer to manage.
   // returns index to be used in work requests
   static int registerBuffer(sample_t *data, size_t frames);
+  // register a mapped loop buffer; clearing it releases memory
+  static int registerBuffer(LoopBuffer &buf);
 
   // clear a portion of a mono buffer
   static void requestClear(size_t idx, float start = 0, float dur = -1);
@@ -89,10 +101,19 @@ class BufDiskWorker {
   static void requestWriteStereo(size_t idx0, size_t idx1, std::string path,
                                  float start = 0, float dur = -1);
 
+  // switch on and build mip levels for a mapped loop buffer
+  static void requestBuildMips(size_t idx);
+
+  // commit memory for a portion of a mapped loop buffer ahead of recording
+  static void requestPrefault(size_t idx, float start, float dur);
+
  private:
   static void workLoop();
 
   static void clearBuffer(BufDesc &buf, float start = 0, float dur = -1);
+  static void prefaultBuffer(BufDesc &buf, float start, float dur);
+  // bring a loop buffer's mip levels up to date after writing to it
+  static void updateMips(BufDesc &buf, size_t start, size_t numFrames);
 
   static void readBufferMono(const std::string &path, BufDesc &buf,
                              float startSrc = 0, float startDst = 0,
@@ -32,7 +32,7 @@ class Bus {
 
   // clear the first N frames in the bus
   void clear(size_t numFrames) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t ch = 0; ch < NumChannels; ++ch) {
       for (size_t fr = 0; fr < numFrames; ++fr) {
         buf[ch][fr] = 0.f;
@@ -42,7 +42,7 @@ class Bus {
 
   // copy from bus, with no scaling (overwrites previous contents)
   void copyFrom(Bus &b, size_t numFrames) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t ch = 0; ch < NumChannels; ++ch) {
       for (size_t fr = 0; fr < numFrames; ++fr) {
         buf[ch][fr] = b.buf[ch][fr];
@@ -53,7 +53,7 @@ class Bus {
   // copy from bus to pointer array, with no scaling (overwrites previous
   // contents)
   void copyTo(float *dst[NumChannels], size_t numFrames) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t ch = 0; ch < NumChannels; ++ch) {
       for (size_t fr = 0; fr < numFrames; ++fr) {
         dst[ch][fr] = buf[ch][fr];
@@ -63,7 +63,7 @@ class Bus {
 
   // sum from bus, without amplitude scaling
   void addFrom(BusT &b, size_t numFrames) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t ch = 0; ch < NumChannels; ++ch) {
       for (size_t fr = 0; fr < numFrames; ++fr) {
         buf[ch][fr] += b.buf[ch][fr];
@@ -73,7 +73,7 @@ class Bus {
 
   // mix from bus, with fixed amplitude
   void mixFrom(BusT &b, size_t numFrames, float level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t ch = 0; ch < NumChannels; ++ch) {
       for (size_t fr = 0; fr < numFrames; ++fr) {
         buf[ch][fr] += b.buf[ch][fr] * level;
@@ -83,7 +83,7 @@ class Bus {
 
   // mix from bus, with smoothed amplitude
   void mixFrom(BusT &b, size_t numFrames, LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float l;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update();
@@ -95,7 +95,7 @@ class Bus {
 
   // apply smoothed amplitude
   void applyGain(size_t numFrames, LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float l;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update();
@@ -108,7 +108,7 @@ class Bus {
   // mix from pointer array, with smoothed amplitude
   void mixFrom(const float *src[NumChannels], size_t numFrames,
                LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float l;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update();
@@ -121,7 +121,7 @@ class Bus {
   // set from pointer array, with smoothed amplitude
   void setFrom(const float *src[NumChannels], size_t numFrames,
                LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float l;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update();
@@ -133,7 +133,7 @@ class Bus {
 
   // set from pointer array, without scaling
   void setFrom(const float *src[NumChannels], size_t numFrames) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t fr = 0; fr < numFrames; ++fr) {
       for (size_t ch = 0; ch < NumChannels; ++ch) {
         buf[ch][fr] = src[ch][fr];
@@ -143,7 +143,7 @@ class Bus {
 
   // mix to pointer array, with smoothed amplitude
   void mixTo(float *dst[NumChannels], size_t numFrames, LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float l;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update();
@@ -155,7 +155,7 @@ class Bus {
 
   // mix from stereo bus with 2x2 level matrix
   void stereoMixFrom(BusT &b, size_t numFrames, const float level[4]) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     for (size_t fr = 0; fr < numFrames; ++fr) {
       buf[0][fr] += b.buf[0][fr] * level[0] + b.buf[1][fr] * level[2];
       buf[1][fr] += b.buf[0][fr] * level[1] + b.buf[1][fr] * level[3];
@@ -164,7 +164,7 @@ class Bus {
 
   // mix from two busses with balance coefficient (linear)
   void xfade(BusT &a, BusT &b, size_t numFrames, LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float x, y, c;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       c = level.update();
@@ -178,7 +178,7 @@ class Bus {
 
   // mix from two busses with balance coefficient (equal power)
   void xfadeEp(BusT &a, BusT &b, size_t numFrames, LogRamp &level) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     float x, y, l, c, d;
     for (size_t fr = 0; fr < numFrames; ++fr) {
       l = level.update() * (float)M_PI_2;
@@ -195,7 +195,7 @@ class Bus {
   // mix from mono->stereo bus, with level and pan (linear)
   void panMixFrom(Bus<1, BlockSize> a, size_t numFrames, LogRamp &level,
                   LogRamp &pan) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     static_assert(NumChannels > 1, "using panMixFrom() on mono bus");
     float l, c, x;
     for (size_t fr = 0; fr < numFrames; ++fr) {
@@ -210,7 +210,7 @@ class Bus {
   // mix from mono->stereo bus, with level and pan (equal power)
   void panMixEpFrom(Bus<1, BlockSize> a, size_t numFrames, LogRamp &level,
                     LogRamp &pan) {
-    assert(numFrames < BlockSize);
+    assert(numFrames <= BlockSize);
     static_assert(NumChannels > 1, "using panMixFrom() on mono bus");
     float l, c, x;
     for (size_t fr = 0; fr < numFrames; ++fr) {
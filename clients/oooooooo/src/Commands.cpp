@@ -4,39 +4,373 @@
 
 #include "Commands.h"
 
+#include <algorithm>
 #include <iostream>
-
-#include "SoftcutClient.h"
+#include <vector>
 
 using namespace softcut_jack_osc;
 
 Commands Commands::softcutCommands;
 
-Commands::Commands() = default;
+namespace {
+// instances that exist, so that exiting threads give lanes back only to
+// those
+struct Registry {
+  std::mutex lock;
+  std::vector<std::pair<const Commands *, uint64_t>> live;
+  uint64_t next = 0;
+  bool isLive(const Commands *c, uint64_t serial) const {
+    return std::find(live.begin(), live.end(), std::make_pair(c, serial)) !=
+           live.end();
+  }
+};
+
+Registry &registry() {
+  static Registry r;
+  return r;
+}
+
+uint64_t addInstance(const Commands *c) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.lock);
+  r.live.emplace_back(c, r.next);
+  return r.next++;
+}
+}  // namespace
+
+// the lanes the calling thread has claimed, per instance
+struct Commands::ThreadLanes {
+  enum { MaxClaims = 4 };
+  struct Claim {
+    Commands *owner;
+    uint64_t serial;
+    int lane;
+  };
+  Claim claims[MaxClaims];
+  int numClaims = 0;
+
+  // forget claims on instances that no longer exist
+  void prune() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.lock);
+    numClaims = static_cast<int>(
+        std::remove_if(claims, claims + numClaims,
+                       [&](const Claim &c) {
+                         return !r.isLive(c.owner, c.serial);
+                       }) -
+        claims);
+  }
+
+  // the thread is exiting: give its lanes back
+  ~ThreadLanes() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.lock);
+    for (int k = 0; k < numClaims; ++k) {
+      const Claim &c = claims[k];
+      if (c.lane < MaxLanes - 1 && r.isLive(c.owner, c.serial)) {
+        c.owner->lanes[c.lane].claimed.store(false, std::memory_order_release);
+      }
+    }
+  }
+};
+
+Commands::Commands() : serial(addInstance(this)) {}
+
+Commands::~Commands() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.lock);
+  r.live.erase(std::find(r.live.begin(), r.live.end(),
+                         std::make_pair(static_cast<const Commands *>(this),
+                                        serial)));
+}
+
+bool Commands::post(Commands::Id id, float f) {
+  return post(CommandPacket(id, -1, f));
+}
+
+bool Commands::post(Commands::Id id, int i, float f) {
+  return post(CommandPacket(id, i, f));
+}
 
-void Commands::post(Commands::Id id, float f) {
-  CommandPacket p(id, -1, f);
-  q.enqueue(p);
+bool Commands::post(Commands::Id id, int i, int j) {
+  return post(CommandPacket(id, i, j));
 }
 
-void Commands::post(Commands::Id id, int i, float f) {
-  CommandPacket p(id, i, f);
-  q.enqueue(p);
+bool Commands::post(Commands::Id id, int i, int j, float f) {
+  return post(CommandPacket(id, i, j, f));
+}
+
+bool Commands::Lane::push(const CommandPacket &p) {
+  const uint32_t w = writeIdx.load(std::memory_order_relaxed);
+  if (w - readIdx.load(std::memory_order_acquire) == LaneCapacity) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  packets[w & (LaneCapacity - 1)] = p;
+  writeIdx.store(w + 1, std::memory_order_release);
+  return true;
 }
 
-void Commands::post(Commands::Id id, int i, int j) {
-  CommandPacket p(id, i, j);
-  q.enqueue(p);
+int Commands::getLane() {
+  thread_local ThreadLanes mine;
+  for (int k = 0; k < mine.numClaims; ++k) {
+    const auto &c = mine.claims[k];
+    if (c.owner == this && c.serial == serial) {
+      return c.lane;
+    }
+  }
+  if (mine.numClaims == ThreadLanes::MaxClaims) {
+    mine.prune();
+  }
+  int lane = MaxLanes - 1;
+  // a thread posting to more instances than it can remember shares
+  if (mine.numClaims < ThreadLanes::MaxClaims) {
+    for (int k = 0; k < MaxLanes - 1; ++k) {
+      // acquire: the lane's last producer is done with it
+      bool expected = false;
+      if (!lanes[k].claimed.load(std::memory_order_relaxed) &&
+          lanes[k].claimed.compare_exchange_strong(
+              expected, true, std::memory_order_acquire)) {
+        lane = k;
+        break;
+      }
+    }
+    mine.claims[mine.numClaims++] = {this, serial, lane};
+  }
+  int used = numLanesUsed.load();
+  while (used <= lane && !numLanesUsed.compare_exchange_weak(used, lane + 1)) {
+  }
+  return lane;
 }
 
-void Commands::post(Commands::Id id, int i, int j, float f) {
-  CommandPacket p(id, i, j, f);
-  q.enqueue(p);
+// how a command's parameter slots are indexed
+enum class Slots { Queued, Global, PerVoice, PerPair };
+
+static Slots getSlots(Commands::Id id) {
+  switch (id) {
+    case Commands::SET_REVERB_MIX:
+    case Commands::SET_REVERB_DECAY:
+    case Commands::SET_REVERB_TAIL_DENSITY:
+    case Commands::SET_REVERB_INPUT_DIFFUSION_1:
+    case Commands::SET_REVERB_INPUT_DIFFUSION_2:
+      return Slots::Global;
+    case Commands::SET_LEVEL_CUT:
+    case Commands::SET_PAN_CUT:
+    case Commands::SET_CUT_RATE:
+    case Commands::SET_CUT_BASE_RATE:
+    case Commands::SET_CUT_FADE_TIME:
+    case Commands::SET_CUT_REC_LEVEL:
+    case Commands::SET_CUT_PRE_LEVEL:
+    case Commands::SET_CUT_REC_OFFSET:
+    case Commands::SET_CUT_PRE_FILTER_FC:
+    case Commands::SET_CUT_PRE_FILTER_FC_MOD:
+    case Commands::SET_CUT_PRE_FILTER_RQ:
+    case Commands::SET_CUT_PRE_FILTER_LP:
+    case Commands::SET_CUT_PRE_FILTER_HP:
+    case Commands::SET_CUT_PRE_FILTER_BP:
+    case Commands::SET_CUT_PRE_FILTER_BR:
+    case Commands::SET_CUT_PRE_FILTER_DRY:
+    case Commands::SET_CUT_POST_FILTER_FC:
+    case Commands::SET_CUT_POST_FILTER_RQ:
+    case Commands::SET_CUT_POST_FILTER_LP:
+    case Commands::SET_CUT_POST_FILTER_HP:
+    case Commands::SET_CUT_POST_FILTER_BP:
+    case Commands::SET_CUT_POST_FILTER_BR:
+    case Commands::SET_CUT_POST_FILTER_DRY:
+    case Commands::SET_CUT_LEVEL_SLEW_TIME:
+    case Commands::SET_CUT_PAN_SLEW_TIME:
+    case Commands::SET_CUT_RECPRE_SLEW_TIME:
+    case Commands::SET_CUT_RATE_SLEW_TIME:
+    case Commands::SET_CUT_DUCK_TIME:
+    case Commands::SET_CUT_TAPE_BIAS:
+    case Commands::SET_CUT_TAPE_PREGAIN:
+    case Commands::SET_REVERB_SEND:
+      return Slots::PerVoice;
+    case Commands::SET_LEVEL_IN_CUT:
+    case Commands::SET_LEVEL_CUT_CUT:
+      return Slots::PerPair;
+    default:
+      // events, flags and anything whose order matters
+      return Slots::Queued;
+  }
 }
 
-void Commands::handlePending(SoftcutClient *client) {
-  CommandPacket p;
-  while (q.try_dequeue(p)) {
-    client->handleCommand(&p);
+bool Commands::isValid(const CommandPacket &p) {
+  const auto voice = [](int i) { return i >= 0 && i < NumVoices; };
+  switch (p.id) {
+    case SET_LEVEL_IN_CUT:
+      return p.idx_0 >= 0 && p.idx_0 < NumInputs && voice(p.idx_1);
+    case SET_LEVEL_CUT_CUT:
+    case SET_CUT_VOICE_SYNC:
+      return voice(p.idx_0) && voice(p.idx_1);
+    case SET_CUT_VOICE_FOLLOW:
+    case SET_CUT_VOICE_DUCK:
+      // a negative voice stops following or ducking
+      return voice(p.idx_0) && (p.idx_1 < 0 || voice(p.idx_1));
+    case SET_CUT_BUFFER:
+      return voice(p.idx_0) && p.idx_1 >= 0 && p.idx_1 < NumBuffers;
+    case SET_REVERB_ENABLED:
+    case RESET:
+      return true;
+    default:
+      // the second index of the rest, if any, is a value
+      return getSlots(p.id) == Slots::Global || voice(p.idx_0);
   }
-}
\ No newline at end of file
+}
+
+int Commands::getSlot(const CommandPacket &p) {
+  switch (getSlots(p.id)) {
+    case Slots::Global:
+      return 0;
+    case Slots::PerVoice:
+      return p.idx_0;
+    case Slots::PerPair:
+      return p.idx_0 * NumVoices + p.idx_1;
+    default:
+      return -1;
+  }
+}
+
+// target frame for the calling thread's queued commands
+static thread_local bool postTimed = false;
+static thread_local uint32_t postFrame = 0;
+
+void Commands::postAtFrame(uint32_t frame) {
+  postTimed = true;
+  postFrame = frame;
+}
+
+void Commands::postNow() { postTimed = false; }
+
+bool Commands::post(const CommandPacket &p) {
+  if (!isValid(p)) {
+    return false;
+  }
+  // a timed parameter change is queued, to land on its frame in order
+  // with the thread's other timed commands
+  const int slot = postTimed ? -1 : getSlot(p);
+  const uint32_t seq = postSeq.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= 0) {
+    params[p.id][slot].store(p.value, std::memory_order_relaxed);
+    paramSeqs[p.id][slot].store(seq, std::memory_order_relaxed);
+    dirty[p.id].fetch_or(uint64_t{1} << slot, std::memory_order_release);
+    return true;
+  }
+  CommandPacket q = p;
+  q.timed = postTimed;
+  q.frame = postFrame;
+  q.seq = seq;
+  const int lane = getLane();
+  if (lane == MaxLanes - 1) {
+    std::lock_guard<std::mutex> lock(sharedLock);
+    return lanes[lane].push(q);
+  }
+  return lanes[lane].push(q);
+}
+
+uint32_t Commands::getDropped() const {
+  uint32_t n = 0;
+  for (const auto &lane : lanes) {
+    n += lane.dropped.load(std::memory_order_relaxed);
+  }
+  return n;
+}
+
+// true if `p` is due by `frame`; frame times wrap around
+static bool isDue(const Commands::CommandPacket &p, uint32_t frame) {
+  return !p.timed || static_cast<int32_t>(p.frame - frame) <= 0;
+}
+
+void Commands::handlePending(Handler *handler, uint32_t frame, int &budget) {
+  const int numLanes = numLanesUsed.load();
+  for (int k = 0; k < numLanes && budget >= 0; ++k) {
+    Lane &lane = lanes[(firstLane + k) % numLanes];
+    uint32_t r = lane.readIdx.load(std::memory_order_relaxed);
+    const uint32_t w = lane.writeIdx.load(std::memory_order_acquire);
+    for (; r != w; ++r) {
+      CommandPacket &p = lane.packets[r & (LaneCapacity - 1)];
+      if (!isDue(p, frame)) {
+        break;
+      }
+      if (budget == 0) {
+        // a due command waits for the next period. counted once per
+        // period: -1 stops the rest of its calls without counting again
+        deferred.fetch_add(1, std::memory_order_relaxed);
+        budget = -1;
+        break;
+      }
+      --budget;
+      if (p.timed && p.frame != frame) {
+        late.fetch_add(1, std::memory_order_relaxed);
+      }
+      // parameters posted before it go first
+      handleParams(handler, true, p.seq);
+      handler->handleCommand(&p);
+      lane.readIdx.store(r + 1, std::memory_order_release);
+    }
+  }
+  if (numLanes > 0) {
+    firstLane = (firstLane + 1) % numLanes;
+  }
+}
+
+bool Commands::getNextFrame(uint32_t &frame) {
+  const int numLanes = numLanesUsed.load();
+  bool found = false;
+  for (int k = 0; k < numLanes; ++k) {
+    Lane &lane = lanes[k];
+    const uint32_t r = lane.readIdx.load(std::memory_order_relaxed);
+    if (r == lane.writeIdx.load(std::memory_order_acquire)) {
+      continue;
+    }
+    const CommandPacket &p = lane.packets[r & (LaneCapacity - 1)];
+    if (p.timed &&
+        (!found || static_cast<int32_t>(p.frame - frame) < 0)) {
+      frame = p.frame;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void Commands::handleParams(Handler *handler, bool bounded, uint32_t seq) {
+  for (int id = 0; id < NUM_COMMANDS; ++id) {
+    if (dirty[id].load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    uint64_t bits = dirty[id].exchange(0, std::memory_order_acquire);
+    uint64_t newer = 0;
+    CommandPacket p;
+    p.id = static_cast<Id>(id);
+    while (bits != 0) {
+      const int slot = __builtin_ctzll(bits);
+      bits &= bits - 1;
+      if (bounded &&
+          static_cast<int32_t>(
+              paramSeqs[id][slot].load(std::memory_order_relaxed) - seq) >= 0) {
+        newer |= uint64_t{1} << slot;
+        continue;
+      }
+      // indices as posted
+      switch (getSlots(p.id)) {
+        case Slots::Global:
+          p.idx_0 = -1;
+          p.idx_1 = -1;
+          break;
+        case Slots::PerPair:
+          p.idx_0 = slot / NumVoices;
+          p.idx_1 = slot % NumVoices;
+          break;
+        default:
+          p.idx_0 = slot;
+          p.idx_1 = -1;
+      }
+      p.value = params[id][slot].load(std::memory_order_relaxed);
+      handler->handleCommand(&p);
+    }
+    if (newer != 0) {
+      // left for later
+      dirty[id].fetch_or(newer, std::memory_order_relaxed);
+    }
+  }
+}
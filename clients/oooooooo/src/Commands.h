@@ -5,13 +5,12 @@
 #ifndef CRONE_COMMANDS_H
 #define CRONE_COMMANDS_H
 
-// #include <boost/lockfree/spsc_queue.hpp>
-#include "readerwriterqueue/readerwriterqueue.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 
 namespace softcut_jack_osc {
 
-class SoftcutClient;
-
 class Commands {
  public:
   typedef enum {
@@ -37,6 +36,8 @@ class Commands {
     SET_CUT_POSITION,
 
     SET_CUT_FADE_TIME,
+    SET_CUT_FADE_SHAPE,
+    SET_CUT_INTERPOLATION,
     SET_CUT_REC_LEVEL,
     SET_CUT_PRE_LEVEL,
     SET_CUT_REC_OFFSET,
@@ -63,22 +64,78 @@ class Commands {
     SET_CUT_RECPRE_SLEW_TIME,
     SET_CUT_RATE_SLEW_TIME,
     SET_CUT_VOICE_SYNC,
+    SET_CUT_VOICE_FOLLOW,
+    SET_CUT_VOICE_DUCK,
+    SET_CUT_DUCK_TIME,
     SET_CUT_BUFFER,
 
     SET_CUT_REC_ONCE,
     SET_CUT_TAPE_BIAS,
     SET_CUT_TAPE_PREGAIN,
+
+    // rate is set * base * direction
+    SET_CUT_BASE_RATE,
+    SET_CUT_RATE_DIRECTION,
+    SET_CUT_PHASE_QUANT,
+    SET_CUT_PHASE_OFFSET,
+
+    //-- reverb commands
+    SET_REVERB_ENABLED,
+    SET_REVERB_MIX,
+    SET_REVERB_SEND,
+    SET_REVERB_DECAY,
+    SET_REVERB_TAIL_DENSITY,
+    SET_REVERB_INPUT_DIFFUSION_1,
+    SET_REVERB_INPUT_DIFFUSION_2,
+
+    // restore all voices and levels to their defaults
+    RESET,
     NUM_COMMANDS,
   } Id;
 
  public:
-  Commands();
-  void post(Commands::Id id, float f);
-  void post(Commands::Id id, int i, float f);
-  void post(Commands::Id id, int i, int j);
-  void post(Commands::Id id, int i, int j, float f);
+  enum {
+    // lanes, one per posting thread; the last is shared by any threads
+    // that find the first MaxLanes - 1 taken. a thread gives its lane
+    // back when it exits
+    MaxLanes = 8,
+    // commands that can wait in one lane; power of two
+    LaneCapacity = 512,
+    // queued commands applied per period, at most, over all the calls to
+    // handlePending() in it. the rest wait for the next period, so a flood
+    // of commands can't run over the audio deadline
+    MaxPerPeriod = 256,
+    // ranges of command indices: voices, input channels and buffers
+    NumVoices = 8,
+    NumInputs = 2,
+    NumBuffers = 2,
+  };
 
-  void handlePending(SoftcutClient *client);
+  Commands();
+  ~Commands();
+  // post from any thread but the audio thread. never allocates.
+  // continuous parameters (levels, filters, rates and so on) go to a
+  // table that keeps only the latest value of each, and are applied
+  // at the start of a block. other commands, and any command posted
+  // for a frame set by postAtFrame(), are queued; those from one thread
+  // are applied in the order they were posted, at their frame if any.
+  // the two paths keep posting order too: before a queued command is
+  // applied, table values posted before it are, so a level set before a
+  // reset can't overwrite it. a value posted after a queued command that
+  // is still waiting (for its frame, or the next period) can be applied
+  // before it, though.
+  // returns false, dropping the command, if an index is out of range
+  // for it or this thread's lane is full
+  bool post(Commands::Id id, float f);
+  bool post(Commands::Id id, int i, float f);
+  bool post(Commands::Id id, int i, int j);
+  bool post(Commands::Id id, int i, int j, float f);
+
+  // commands posted by the calling thread from now on wait for JACK frame
+  // `frame`, continuous parameters too; postNow() goes back to applying
+  // them as soon as possible
+  static void postAtFrame(uint32_t frame);
+  static void postNow();
 
   struct CommandPacket {
     CommandPacket() = default;
@@ -92,14 +149,91 @@ class Commands {
     int idx_0{};
     int idx_1{};
     float value{};
+    // apply at JACK frame `frame`, rather than as soon as possible
+    bool timed{};
+    uint32_t frame{};
+    // when it was posted, among all commands
+    uint32_t seq{};
   };
 
+  // what commands are applied to
+  class Handler {
+   public:
+    virtual ~Handler() = default;
+    virtual void handleCommand(CommandPacket *p) = 0;
+  };
+
+  //-- audio thread
+
+  // apply queued commands that are due by JACK frame `frame`, taking
+  // each from `budget`, which the caller sets to MaxPerPeriod at the start
+  // of a period. a lane waits at its first command that is not due
+  void handlePending(Handler *handler, uint32_t frame, int &budget);
+  // JACK frame of the earliest timed command at the head of a lane.
+  // returns false if there is none
+  bool getNextFrame(uint32_t &frame);
+  // apply changed parameters
+  void handleParams(Handler *handler) { handleParams(handler, false, 0); }
+
   static Commands softcutCommands;
 
+  // commands dropped because a lane was full
+  uint32_t getDropped() const;
+  // periods that left due commands waiting because they hit MaxPerPeriod
+  uint32_t getDeferred() const {
+    return deferred.load(std::memory_order_relaxed);
+  }
+  // timed commands applied after their frame: posted too late, or due
+  // where the client could no longer split a period for them
+  uint32_t getLate() const { return late.load(std::memory_order_relaxed); }
+
  private:
-  //        boost::lockfree::spsc_queue <CommandPacket,
-  //                boost::lockfree::capacity<200> > q;
-  moodycamel::ReaderWriterQueue<CommandPacket> q;
+  // single producer, single consumer ring with free-running indices,
+  // as in EventRing
+  struct Lane {
+    CommandPacket packets[LaneCapacity];
+    alignas(64) std::atomic<uint32_t> writeIdx{0};
+    alignas(64) std::atomic<uint32_t> readIdx{0};
+    std::atomic<uint32_t> dropped{0};
+    // a thread posts to it; never set for the shared lane
+    std::atomic<bool> claimed{false};
+    bool push(const CommandPacket &p);
+  };
+  struct ThreadLanes;
+
+  bool post(const CommandPacket &p);
+  // the lane for the calling thread, claimed on its first post: a free
+  // one, or else the shared one
+  int getLane();
+  // true if the indices of `p` are in range for its command
+  static bool isValid(const CommandPacket &p);
+  // the parameter slot for `p`, or -1 if it is queued
+  static int getSlot(const CommandPacket &p);
+  // apply changed parameters; if `bounded`, only those posted before `seq`
+  void handleParams(Handler *handler, bool bounded, uint32_t seq);
+
+  Lane lanes[MaxLanes];
+  // one past the highest lane ever claimed; handlePending() looks no
+  // further
+  std::atomic<int> numLanesUsed{0};
+  // tells this instance from one made later at the same address
+  const uint64_t serial;
+  // serializes the threads sharing the last lane
+  std::mutex sharedLock;
+  // lane handlePending() starts from, so no lane is always last
+  int firstLane = 0;
+  std::atomic<uint32_t> deferred{0};
+  std::atomic<uint32_t> late{0};
+  // numbers posts, so the table and the queue can be applied in order
+  std::atomic<uint32_t> postSeq{0};
+
+  // latest value of each parameter: one slot per voice, or per pair of
+  // indices, so each command's slots fit one word of dirty bits
+  enum { NumSlots = NumVoices * NumVoices };
+  std::atomic<float> params[NUM_COMMANDS][NumSlots];
+  // seq of each slot's latest value
+  std::atomic<uint32_t> paramSeqs[NUM_COMMANDS][NumSlots];
+  std::atomic<uint64_t> dirty[NUM_COMMANDS] = {};
 };
 
 }  // namespace softcut_jack_osc
@@ -238,8 +238,8 @@ void Display::renderLoop() {
                                           totalSeconds * baseRate, false);
 
           // cut to the start
-          softCutClient_->handleCommand(new Commands::CommandPacket(
-              Commands::Id::SET_CUT_POSITION, selected_loop, startTimeDest));
+          Commands::softcutCommands.post(Commands::Id::SET_CUT_POSITION,
+                                         selected_loop, startTimeDest);
 
           std::string fileName(e.drop.file);
           size_t lastSlash = fileName.find_last_of("/\\");
@@ -396,6 +396,13 @@ void Display::renderLoop() {
     SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 255);  // Black background
     SDL_RenderSetLogicalSize(renderer_, width_, height_);
     SDL_RenderClear(renderer_);
+    // events from the audio thread since the last frame
+    if (softCutClient_) {
+      Event e;
+      while (softCutClient_->getUiEvents().pop(e)) {
+        params_[e.voice].HandleEvent(e);
+      }
+    }
     introAnimation_.Update();
     if (!introAnimation_.isComplete()) {
       // Render only intro animation
@@ -523,6 +530,26 @@ void Display::renderLoop() {
       cpuUsage = softCutClient_->getCPUUsage();
     }
     std::string cpuText = sprintf_str("CPU: %.0f%%", roundf(cpuUsage));
+    // with several render threads, add the load on each
+    if (softCutClient_ && softCutClient_->getNumRenderThreads() > 1) {
+      for (int i = 0; i < softCutClient_->getNumRenderThreads(); ++i) {
+        cpuText += sprintf_str(
+            i == 0 ? " [%.0f" : " %.0f",
+            roundf(softCutClient_->getRenderLoad(i) * 100.f));
+      }
+      cpuText += "]";
+    }
+    // commands lost or held back by a flood of them
+    if (softCutClient_) {
+      const uint32_t dropped = softCutClient_->getDroppedCommands();
+      const uint32_t deferred = softCutClient_->getDeferredCommands();
+      const uint32_t late = softCutClient_->getLateCommands();
+      if (dropped > 0 || deferred > 0 || late > 0) {
+        cpuText = sprintf_str("CMD: %u dropped %u deferred %u late  ",
+                              dropped, deferred, late) +
+                  cpuText;
+      }
+    }
     int cpuTextWidth, cpuTextHeight;
     TTF_SizeText(font, cpuText.c_str(), &cpuTextWidth, &cpuTextHeight);
     SDL_Surface* cpuTextSurface = TTF_RenderText_Solid(
@@ -614,8 +641,7 @@ void Display::init(SoftcutClient* sc, int numVoices) {
 
   // set input level to 1.0 for all voices for channel 0
   for (int i = 0; i < numVoices_; i++) {
-    softCutClient_->handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_LEVEL_IN_CUT, 0, i, 1.0f));
+    Commands::softcutCommands.post(Commands::Id::SET_LEVEL_IN_CUT, 0, i, 1.0f);
   }
 }
 
@@ -120,9 +120,9 @@ void DisplayRing::RegisterClick(float mouseX, float mouseY) {
         fmod((angle + 2 * M_PI), (2 * M_PI)) / (2 * M_PI);
 
     // do cut
-    softCutClient_->handleCommand(new Commands::CommandPacket(
+    Commands::softcutCommands.post(
         Commands::Id::SET_CUT_POSITION, id_,
-        start_ + dur_ * clicked_radius_angle_normalized_));
+        start_ + dur_ * clicked_radius_angle_normalized_);
   }
 }
 
@@ -0,0 +1,126 @@
+/*
+ * EventRing carries events from the JACK thread to one consumer thread.
+ *
+ * single producer, single consumer, fixed capacity, no locks and no
+ * allocation. the producer pushes a period's events and then calls
+ * notify(), which only makes a syscall if the consumer is asleep in wait().
+ * events that do not fit are dropped and counted.
+ * consumers that have their own frame loop can just drain it with pop().
+ */
+
+#ifndef CRONE_EVENTRING_H
+#define CRONE_EVENTRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "Futex.h"
+
+namespace softcut_jack_osc {
+
+struct Event {
+  enum Type : uint8_t {
+    // from the voices, as softcut::VoiceEvent::Type
+    LoopWrap,      // passed a loop point
+    QuantPhase,    // quantized phase changed
+    RecOnceDone,   // finished recording once
+    RecordStop,    // record flag went off, for whatever reason
+    PrimeTrigger,  // input crossed the prime threshold and recording began
+  };
+  Type type;
+  int voice;
+  // JACK frame time at which it happened
+  uint32_t frame;
+  // in seconds: the position jumped to for LoopWrap, the new quantized
+  // phase for QuantPhase, the position at the end of the period for
+  // RecordStop
+  float value;
+};
+
+class EventRing {
+ public:
+  enum { Capacity = 1024 };  // power of two
+
+  EventRing() = default;
+  EventRing(const EventRing &) = delete;
+  EventRing &operator=(const EventRing &) = delete;
+
+  //-- producer
+
+  // returns false, dropping `e`, if the ring is full
+  bool push(const Event &e) {
+    const uint32_t w = writeIdx.load(std::memory_order_relaxed);
+    if (w - readIdx.load(std::memory_order_acquire) == Capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    events[w & (Capacity - 1)] = e;
+    writeIdx.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  // wake the consumer, if it is waiting
+  void notify() {
+#ifdef __linux__
+    if (sleeping.load()) {
+      futexWake(&writeIdx);
+    }
+#endif
+  }
+
+  //-- consumer
+
+  // returns false if the ring is empty
+  bool pop(Event &e) {
+    const uint32_t r = readIdx.load(std::memory_order_relaxed);
+    if (r == writeIdx.load(std::memory_order_acquire)) {
+      return false;
+    }
+    e = events[r & (Capacity - 1)];
+    readIdx.store(r + 1, std::memory_order_release);
+    return true;
+  }
+
+  // block until the ring has events or `timeoutMs` has passed.
+  // returns false on timeout
+  bool wait(int timeoutMs) {
+    const uint32_t r = readIdx.load(std::memory_order_relaxed);
+#ifdef __linux__
+    // notify() reads `sleeping` after publishing events, and we set it
+    // before checking for them, so one of us always sees the other
+    sleeping.store(true);
+    if (writeIdx.load() == r) {
+      futexWait(&writeIdx, r, timeoutMs);
+    }
+    sleeping.store(false, std::memory_order_relaxed);
+#else
+    // no futex: poll
+    const auto until = std::chrono::steady_clock::now() +
+                       std::chrono::milliseconds(timeoutMs);
+    while (writeIdx.load(std::memory_order_acquire) == r &&
+           std::chrono::steady_clock::now() < until) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+    return writeIdx.load(std::memory_order_acquire) != r;
+  }
+
+  // events dropped because the ring was full
+  uint32_t getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  Event events[Capacity];
+  // free-running indices; futex word for wait()
+  alignas(64) std::atomic<uint32_t> writeIdx{0};
+  alignas(64) std::atomic<uint32_t> readIdx{0};
+  std::atomic<bool> sleeping{false};
+  std::atomic<uint32_t> dropped{0};
+};
+
+}  // namespace softcut_jack_osc
+
+#endif  // CRONE_EVENTRING_H
@@ -0,0 +1,42 @@
+/*
+ * minimal futex wrappers for threads that wait on an atomic word.
+ * linux only; callers need their own fallback elsewhere.
+ */
+
+#ifndef CRONE_FUTEX_H
+#define CRONE_FUTEX_H
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace softcut_jack_osc {
+
+#ifdef __linux__
+// sleep while `*word` is `val`, for at most `timeoutMs` if not negative.
+// may return early, so callers re-check the word
+inline void futexWait(std::atomic<uint32_t> *word, uint32_t val,
+                      int timeoutMs = -1) {
+  struct timespec ts;
+  ts.tv_sec = timeoutMs / 1000;
+  ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE,
+          val, timeoutMs < 0 ? nullptr : &ts, nullptr, 0);
+}
+
+// wake one thread waiting on `word`
+inline void futexWake(std::atomic<uint32_t> *word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE,
+          1, nullptr, nullptr, 0);
+}
+#endif
+
+}  // namespace softcut_jack_osc
+
+#endif  // CRONE_FUTEX_H
@@ -26,7 +26,7 @@
 namespace softcut_jack_osc {
 
 template <int NumIns, int NumOuts>
-class JackClient {
+class JackClient : public Commands::Handler {
  private:
   static_assert(NumIns % 2 == 0, "non-even input count");
   static_assert(NumOuts % 2 == 0, "non-even output count");
@@ -73,8 +73,11 @@ class JackClient {
 
   virtual void setSampleRate(jack_nframes_t sr) = 0;
 
+  // called before the first period, and whenever the period size changes
+  virtual void setBufferSize(jack_nframes_t numFrames) = 0;
+
  public:
-  virtual void handleCommand(Commands::CommandPacket* p) = 0;
+  void handleCommand(Commands::CommandPacket* p) override = 0;
 
   float getCPULoad() {
     // Get the CPU load from the JACK client
@@ -92,6 +95,11 @@ class JackClient {
     self->process(numFrames);
     return 0;
   }
+  static int bufferSizeCallback(jack_nframes_t numFrames, void* data) {
+    auto* self = (JackClient*)(data);
+    self->setBufferSize(numFrames);
+    return 0;
+  }
   // static handler for shutdown from jack
   static void jack_shutdown(void* data) {
     (void)data;
@@ -121,6 +129,8 @@ class JackClient {
     }
 
     jack_set_process_callback(client, JackClient::callback, this);
+    jack_set_buffer_size_callback(client, JackClient::bufferSizeCallback,
+                                  this);
     jack_on_shutdown(client, jack_shutdown, this);
 
     auto sr = jack_get_sample_rate(client);
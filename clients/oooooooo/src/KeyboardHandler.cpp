@@ -54,8 +54,8 @@ void KeyboardHandler::handleKeyDown(SDL_Keycode key, bool isRepeat,
           softcut_->TogglePlay(*selectedLoop, false);
           float startTimeDest = softcut_->getLoopStart(*selectedLoop);
           // cut to the start
-          softcut_->handleCommand(new Commands::CommandPacket(
-              Commands::Id::SET_CUT_POSITION, *selectedLoop, startTimeDest));
+          Commands::softcutCommands.post(Commands::Id::SET_CUT_POSITION,
+                                         *selectedLoop, startTimeDest);
 
         } else {
           if (softcut_->WasPrimed(*selectedLoop) &&
@@ -109,9 +109,9 @@ void KeyboardHandler::handleKeyDown(SDL_Keycode key, bool isRepeat,
             // set playing to off
             softcut_->TogglePlay(*selectedLoop, false);
             // set position to 0
-            softcut_->handleCommand(new Commands::CommandPacket(
+            Commands::softcutCommands.post(
                 Commands::Id::SET_CUT_POSITION, *selectedLoop,
-                softcut_->getLoopStart(*selectedLoop)));
+                softcut_->getLoopStart(*selectedLoop));
 
             // clear the buffer
             softcut_->clearBuffer(*selectedLoop < 4 ? 0 : 1,
@@ -0,0 +1,335 @@
+#include "LoopBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace softcut_jack_osc;
+
+static size_t pageSize() {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwPageSize);
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#ifdef __linux__
+// count pages that are present and exclusively mapped, from the pagemap.
+// untouched pages that have only been read all map the shared zero page,
+// so this leaves them out (mincore() would count them as resident.)
+static bool countPrivatePages(const void *addr, size_t numPages,
+                              size_t &count) {
+  int fd = open("/proc/self/pagemap", O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  constexpr uint64_t present = 1ull << 63;
+  constexpr uint64_t exclusive = 1ull << 56;
+  constexpr size_t chunk = 4096;
+  uint64_t entries[chunk];
+  off_t offset = static_cast<off_t>(reinterpret_cast<uintptr_t>(addr) /
+                                    pageSize() * sizeof(uint64_t));
+  count = 0;
+  bool ok = true;
+  while (numPages > 0) {
+    const size_t n = std::min(numPages, chunk);
+    const ssize_t bytes = pread(fd, entries, n * sizeof(uint64_t), offset);
+    if (bytes != static_cast<ssize_t>(n * sizeof(uint64_t))) {
+      ok = false;
+      break;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if ((entries[i] & (present | exclusive)) == (present | exclusive)) {
+        ++count;
+      }
+    }
+    offset += static_cast<off_t>(n * sizeof(uint64_t));
+    numPages -= n;
+  }
+  close(fd);
+  return ok;
+}
+#endif
+
+LoopBuffer::LoopBuffer(size_t frames)
+    : frames_(frames),
+      bytes_(frames * sizeof(softcut::sample_t)),
+      mipChunkFrames_(std::max<size_t>(frames / MipChunks, 1)) {
+  void *p;
+#ifdef _WIN32
+  // committed pages are zero-filled and only get physical memory on first
+  // access
+  p = VirtualAlloc(nullptr, bytes_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+#else
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+  p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+#endif
+  data_ = static_cast<softcut::sample_t *>(p);
+}
+
+LoopBuffer::~LoopBuffer() {
+#ifdef _WIN32
+  VirtualFree(data_, 0, MEM_RELEASE);
+#else
+  munmap(data_, bytes_);
+#endif
+}
+
+size_t LoopBuffer::committedBytes() const {
+#ifdef _WIN32
+  // no portable residency query; the whole mapping is committed
+  return bytes_;
+#else
+  const size_t page = pageSize();
+  const size_t numPages = (bytes_ + page - 1) / page;
+#ifdef __linux__
+  size_t count;
+  if (countPrivatePages(data_, numPages, count)) {
+    return std::min(count * page, bytes_);
+  }
+#endif
+#ifdef __APPLE__
+  std::vector<char> vec(numPages);
+#else
+  std::vector<unsigned char> vec(numPages);
+#endif
+  if (mincore(data_, bytes_, vec.data()) != 0) {
+    return bytes_;
+  }
+  size_t resident = 0;
+  for (auto v : vec) {
+    resident += (v & 1);
+  }
+  return std::min(resident * page, bytes_);
+#endif
+}
+
+void LoopBuffer::prefault(size_t start, size_t numFrames) {
+  if (start >= frames_) {
+    return;
+  }
+  numFrames = std::min(numFrames, frames_ - start);
+  // the mapping is page aligned, so rounding down stays inside it
+  const uintptr_t page = pageSize();
+  const auto a = reinterpret_cast<uintptr_t>(data_ + start) & ~(page - 1);
+  const auto b = reinterpret_cast<uintptr_t>(data_ + start + numFrames);
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+  // (MADV_WILLNEED doesn't populate anonymous memory)
+  if (madvise(reinterpret_cast<void *>(a), b - a, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+#endif
+  // write each page without changing it. an atomic add of zero can't undo
+  // a store the audio thread makes to the same word meanwhile
+  for (uintptr_t p = a; p < b; p += page) {
+    __atomic_fetch_add(reinterpret_cast<uint64_t *>(p), 0, __ATOMIC_RELAXED);
+  }
+}
+
+void LoopBuffer::clear(size_t start, size_t numFrames) {
+  if (start >= frames_) {
+    return;
+  }
+  numFrames = std::min(numFrames, frames_ - start);
+  auto *a = reinterpret_cast<uint8_t *>(data_ + start);
+  auto *b = reinterpret_cast<uint8_t *>(data_ + start + numFrames);
+
+#ifdef _WIN32
+  std::memset(a, 0, static_cast<size_t>(b - a));
+#else
+  // round inward to whole pages; zero the partial pages at either end
+  const uintptr_t page = pageSize();
+  auto *pa = reinterpret_cast<uint8_t *>(
+      (reinterpret_cast<uintptr_t>(a) + page - 1) & ~(page - 1));
+  auto *pb = reinterpret_cast<uint8_t *>(reinterpret_cast<uintptr_t>(b) &
+                                         ~(page - 1));
+  if (pa >= pb) {
+    std::memset(a, 0, static_cast<size_t>(b - a));
+    return;
+  }
+  std::memset(a, 0, static_cast<size_t>(pa - a));
+  std::memset(pb, 0, static_cast<size_t>(b - pb));
+  const size_t len = static_cast<size_t>(pb - pa);
+#ifdef __linux__
+  // private anonymous pages read back as zero after this
+  if (madvise(pa, len, MADV_DONTNEED) == 0) {
+    return;
+  }
+#else
+  // replace the range with fresh zero pages
+  if (mmap(pa, len, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1,
+           0) != MAP_FAILED) {
+    return;
+  }
+#endif
+  std::memset(pa, 0, len);
+#endif
+}
+
+void LoopBuffer::enableMips() {
+  int s = mipState_.load(std::memory_order_acquire);
+  if (s == MipsDropping) {
+    s = waitMips(s);
+  }
+  // voices neither read nor update the levels until they are on, so this
+  // thread has them to itself until it hands them over
+  if (s != MipsOff || !mipState_.compare_exchange_strong(s, MipsBuilding)) {
+    return;
+  }
+  // marks from before were for writes the build reads anyway
+  for (auto &m : mipMarks_) {
+    m.store(0, std::memory_order_relaxed);
+  }
+  if (mipStorage_ == nullptr) {
+    const auto frames = static_cast<unsigned int>(frames_);
+    mipStorage_ = std::make_unique<LoopBuffer>(
+        softcut::Mipmap::storageFrames(frames));
+    mips_.setBuffer(data_, mipStorage_->data(), frames);
+  }
+  mips_.rebuild();
+  finishMips();
+}
+
+void LoopBuffer::disableMips() {
+  int s = mipState_.load(std::memory_order_acquire);
+  for (;;) {
+    int to;
+    if (s == MipsOn || s == MipsReclaiming) {
+      to = MipsDropping;
+    } else if (s == MipsBuilding || s == MipsBuilt) {
+      // not handed over yet; a build in progress is left unfinished
+      to = MipsOff;
+    } else {
+      return;
+    }
+    if (mipState_.compare_exchange_weak(s, to)) {
+      return;
+    }
+  }
+}
+
+int LoopBuffer::waitMips(int s) {
+  int t;
+  while ((t = mipState_.load(std::memory_order_acquire)) == s) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return t;
+}
+
+void LoopBuffer::finishMips() {
+  // catch up with what was recorded during the build. recording can keep
+  // marking chunks as fast as they are redone, so stop after a few passes;
+  // whatever is left is redone by syncMips()
+  for (int k = 0; k < 4 && rebuildMarked(); ++k) {
+  }
+  int s = MipsBuilding;
+  mipState_.compare_exchange_strong(s, MipsBuilt);
+}
+
+void LoopBuffer::markWritten(long lo, long hi) {
+  const long n = static_cast<long>(frames_);
+  if (hi - lo + 1 >= n) {
+    lo = 0;
+    hi = n - 1;
+  }
+  const long cf = static_cast<long>(mipChunkFrames_);
+  // chunks, rounding down for negative frames
+  const long c0 = lo >= 0 ? lo / cf : -((cf - 1 - lo) / cf);
+  const long c1 = hi >= 0 ? hi / cf : -((cf - 1 - hi) / cf);
+  for (long c = c0; c <= c1; ++c) {
+    const auto k = static_cast<unsigned long>(c) % MipChunks;
+    mipMarks_[k / 64].fetch_or(1ull << (k % 64), std::memory_order_release);
+  }
+}
+
+bool LoopBuffer::rebuildMarked() {
+  bool any = false;
+  for (int w = 0; w < MipChunks / 64; ++w) {
+    uint64_t bits = mipMarks_[w].exchange(0, std::memory_order_acquire);
+    for (int b = 0; bits != 0; ++b, bits >>= 1) {
+      if (bits & 1) {
+        const auto lo = static_cast<long>((w * 64 + b) * mipChunkFrames_);
+        mips_.update(lo, lo + static_cast<long>(mipChunkFrames_) - 1);
+        any = true;
+      }
+    }
+  }
+  return any;
+}
+
+void LoopBuffer::syncMips() {
+  int s = mipState_.load(std::memory_order_acquire);
+  switch (s) {
+    case MipsBuilt:
+      // switch on first, so that the building thread can no longer take
+      // them back while the rest is redone here
+      if (mipState_.compare_exchange_strong(s, MipsOn)) {
+        rebuildMarked();
+      }
+      break;
+    case MipsDropping:
+      mipState_.compare_exchange_strong(s, MipsOff);
+      break;
+    case MipsReclaiming:
+      mipState_.compare_exchange_strong(s, MipsBuilding);
+      break;
+    default:
+      break;
+  }
+}
+
+void LoopBuffer::updateMips(size_t start, size_t numFrames) {
+  if (numFrames == 0) {
+    return;
+  }
+  // take the levels back from the audio thread, or from syncMips() if it
+  // hasn't switched them on yet
+  int s = mipState_.load(std::memory_order_acquire);
+  for (;;) {
+    if (s == MipsOn) {
+      if (mipState_.compare_exchange_weak(s, MipsReclaiming)) {
+        s = waitMips(MipsReclaiming);
+        break;
+      }
+    } else if (s == MipsBuilt) {
+      if (mipState_.compare_exchange_weak(s, MipsBuilding)) {
+        s = MipsBuilding;
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+  // off, or switched off meanwhile
+  if (s != MipsBuilding) {
+    return;
+  }
+  mips_.update(static_cast<long>(start),
+               static_cast<long>(start + numFrames) - 1);
+  finishMips();
+}
@@ -0,0 +1,115 @@
+/*
+ * LoopBuffer owns one mono audio buffer backed by an anonymous memory
+ * mapping. address space for the whole buffer is reserved up front, but
+ * physical pages are only committed when first written, so a large buffer
+ * costs nothing until voices actually record into it.
+ *
+ * it can also keep mip levels of the buffer, for playback above unity rate
+ * (see softcut::Mipmap.) these are off by default: they take another 7/8
+ * of the buffer's size, mapped the same way.
+ */
+
+#ifndef CRONE_LOOPBUFFER_H
+#define CRONE_LOOPBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "softcut/Mipmap.h"
+#include "softcut/Types.h"
+
+namespace softcut_jack_osc {
+
+class LoopBuffer {
+ public:
+  explicit LoopBuffer(size_t frames);
+  ~LoopBuffer();
+  LoopBuffer(const LoopBuffer &) = delete;
+  LoopBuffer &operator=(const LoopBuffer &) = delete;
+
+  softcut::sample_t *data() { return data_; }
+  size_t frames() const { return frames_; }
+
+  // size of the mapping
+  size_t reservedBytes() const { return bytes_; }
+  // bytes currently backed by physical memory
+  size_t committedBytes() const;
+
+  // give a range of frames physical memory now, so that recording into it
+  // doesn't take page faults on the audio thread. contents are unchanged,
+  // and the audio thread may write to the range meanwhile.
+  // not for the audio thread
+  void prefault(size_t start, size_t numFrames);
+
+  // zero a range of frames.
+  // whole pages inside the range are handed back to the system,
+  // so they read as zero and no longer count as committed.
+  void clear(size_t start, size_t numFrames);
+
+  // mip levels, or null unless they are on.
+  // safe to call from any thread
+  softcut::Mipmap *mips() {
+    return mipState_.load(std::memory_order_acquire) == MipsOn ? &mips_
+                                                               : nullptr;
+  }
+  // map storage for the levels if needed and build them; syncMips() then
+  // switches them on. not for the audio thread. frames that voices record
+  // meanwhile must be reported with markWritten(), to be built again
+  void enableMips();
+  // switch the levels off; voices let go of them from the next period
+  void disableMips();
+  // true while the levels are being built, so writes must be reported
+  bool mipsBuilding() const {
+    const int s = mipState_.load(std::memory_order_acquire);
+    return s == MipsBuilding || s == MipsBuilt;
+  }
+  // report frames [lo, hi], wrapping, as written since the levels were last
+  // built. call after the writes, from any thread
+  void markWritten(long lo, long hi);
+  // on the audio thread, before voices pick up mips() for a block: hand the
+  // levels over between the audio thread and the others
+  void syncMips();
+  // build the levels again over frames written other than through a voice.
+  // not for the audio thread
+  void updateMips(size_t start, size_t numFrames);
+
+ private:
+  softcut::sample_t *data_;
+  size_t frames_;
+  size_t bytes_;
+
+  // the levels belong to the audio thread while on, and to the building
+  // thread while building. a thread taking them back from the audio thread
+  // waits for syncMips() to let go of them (Dropping -> Off, Reclaiming ->
+  // Building), since voices hold on to them for the rest of the block
+  enum MipState {
+    MipsOff,
+    MipsBuilding,
+    MipsBuilt,
+    MipsOn,
+    MipsDropping,
+    MipsReclaiming
+  };
+  // wait for syncMips() to move on from state `s`, returning the new state
+  int waitMips(int s);
+  // build the levels again over marked chunks, clearing the marks.
+  // returns false if there were none
+  bool rebuildMarked();
+  // catch up with marked writes, then leave the levels to syncMips()
+  void finishMips();
+
+  // the buffer is split into this many chunks for marking writes
+  static constexpr int MipChunks = 8192;
+  softcut::Mipmap mips_;
+  std::unique_ptr<LoopBuffer> mipStorage_;
+  std::atomic<int> mipState_{MipsOff};
+  // one bit per chunk written while building
+  std::atomic<uint64_t> mipMarks_[MipChunks / 64] = {};
+  size_t mipChunkFrames_;
+};
+
+}  // namespace softcut_jack_osc
+
+#endif  // CRONE_LOOPBUFFER_H
@@ -12,6 +12,7 @@
 #include "BufDiskWorker.h"
 #include "Commands.h"
 #include "OscInterface.h"
+#include "OscTime.h"
 #include "softcut/FadeCurves.h"
 
 using namespace softcut_jack_osc;
@@ -28,8 +29,11 @@ std::array<OscInterface::OscMethod, OscInterface::MaxNumMethods>
 unsigned int OscInterface::numMethods = 0;
 
 std::unique_ptr<Poll> OscInterface::vuPoll;
-std::unique_ptr<Poll> OscInterface::phasePoll;
 SoftcutClient *OscInterface::softCutClient;
+std::thread OscInterface::eventThread;
+std::atomic<bool> OscInterface::eventQuit;
+std::atomic<bool> OscInterface::phasePolling;
+std::atomic<bool> OscInterface::eventPolling;
 
 OscInterface::OscMethod::OscMethod(string p, string f, OscInterface::Handler h)
     : path(std::move(p)), format(std::move(f)), handler(h) {}
@@ -46,26 +50,46 @@ void OscInterface::init(SoftcutClient *sc) {
 
   std::cout << "OSC server listening on port " << port << std::endl;
   st = lo_server_thread_new(port.c_str(), handleLoError);
+  dispatchOnArrival(st);
   addServerMethods();
 
   softCutClient = sc;
 
-  //--- softcut phase poll
-  phasePoll = std::make_unique<Poll>("softcut/phase");
-  phasePoll->setCallback([](const char *path) {
-    for (int i = 0; i < softCutClient->getNumVoices(); ++i) {
-      if (softCutClient->checkVoiceQuantPhase(i)) {
-        lo_send(clientAddress, path, "if", i, softCutClient->getQuantPhase(i));
+  //--- softcut events, including phase poll;
+  // the thread sleeps until the audio thread has something to send
+  phasePolling = false;
+  eventPolling = false;
+  eventQuit = false;
+  eventThread = std::thread([] {
+    EventRing &ring = softCutClient->getOscEvents();
+    Event e;
+    while (!eventQuit) {
+      ring.wait(100);
+      while (ring.pop(e)) {
+        sendEvent(e);
       }
     }
   });
-  phasePoll->setPeriod(1);
-
-  //--- TODO: softcut trigger poll?
 
   lo_server_thread_start(st);
 }
 
+void OscInterface::sendEvent(const Event &e) {
+  if (e.type == Event::QuantPhase && phasePolling) {
+    lo_send(clientAddress, "/poll/softcut/phase", "if", e.voice, e.value);
+  }
+  if (!eventPolling) {
+    return;
+  }
+  static const char *paths[] = {
+      "/event/cut/loop_wrap",     "/event/cut/quant_phase",
+      "/event/cut/rec_once_done", "/event/cut/rec_stop",
+      "/event/cut/prime",
+  };
+  lo_send(clientAddress, paths[e.type], "ihf", e.voice,
+          static_cast<int64_t>(e.frame), e.value);
+}
+
 void OscInterface::addServerMethod(const char *path, const char *format,
                                    Handler handler) {
   OscMethod m(path, format, handler);
@@ -76,10 +100,19 @@ void OscInterface::addServerMethod(const char *path, const char *format,
          lo_message msg, void *data) -> int {
         (void)path;
         (void)types;
-        (void)msg;
         auto pm = static_cast<OscMethod *>(data);
         // std::cerr << "osc rx: " << path << std::endl;
+        // messages from a timetagged bundle post commands for the frame
+        // the timetag falls on
+        double sec;
+        const bool timed = getSecondsUntil(msg, sec);
+        if (timed) {
+          Commands::postAtFrame(softCutClient->getFrameAfter(sec));
+        }
         pm->handler(argv, argc);
+        if (timed) {
+          Commands::postNow();
+        }
         return 0;
       },
       &(methods[numMethods]));
@@ -215,6 +248,27 @@ void OscInterface::addServerMethods() {
                                        argv[0]->i, argv[1]->f);
       });
 
+  // 0: linear, 1: equal power (default), 2: raised cosine
+  addServerMethod(
+      "/set/param/cut/fade_shape", "ii", [](lo_arg **argv, int argc) {
+        if (argc < 2) {
+          return;
+        }
+        Commands::softcutCommands.post(Commands::Id::SET_CUT_FADE_SHAPE,
+                                       argv[0]->i, argv[1]->i);
+      });
+
+  // 0: linear, 1: 4-point hermite (default), 2: 6-point hermite,
+  // 3: 16-point windowed sinc
+  addServerMethod(
+      "/set/param/cut/interpolation", "ii", [](lo_arg **argv, int argc) {
+        if (argc < 2) {
+          return;
+        }
+        Commands::softcutCommands.post(Commands::Id::SET_CUT_INTERPOLATION,
+                                       argv[0]->i, argv[1]->i);
+      });
+
   addServerMethod(
       "/set/param/cut/rec_level", "if", [](lo_arg **argv, int argc) {
         if (argc < 2) {
@@ -237,6 +291,9 @@ void OscInterface::addServerMethods() {
     if (argc < 2) {
       return;
     }
+    if (argv[1]->f > 0.f) {
+      softCutClient->prefaultLoop(argv[0]->i);
+    }
     Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_FLAG, argv[0]->i,
                                    argv[1]->f);
   });
@@ -245,6 +302,9 @@ void OscInterface::addServerMethods() {
     if (argc < 2) {
       return;
     }
+    if (argv[1]->f > 0.f) {
+      softCutClient->prefaultLoop(argv[0]->i);
+    }
     Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_ONCE, argv[0]->i,
                                    argv[1]->f);
   });
@@ -421,6 +481,36 @@ void OscInterface::addServerMethods() {
                                        argv[0]->i, argv[1]->i, argv[2]->f);
       });
 
+  // hard-sync a voice to another, or stop with a negative leader
+  addServerMethod(
+      "/set/param/cut/voice_follow", "ii", [](lo_arg **argv, int argc) {
+        if (argc < 2) {
+          return;
+        }
+        Commands::softcutCommands.post(Commands::Id::SET_CUT_VOICE_FOLLOW,
+                                       argv[0]->i, argv[1]->i);
+      });
+
+  // duck a voice's playback around another's record position,
+  // or stop with a negative reference
+  addServerMethod(
+      "/set/param/cut/voice_duck", "ii", [](lo_arg **argv, int argc) {
+        if (argc < 2) {
+          return;
+        }
+        Commands::softcutCommands.post(Commands::Id::SET_CUT_VOICE_DUCK,
+                                       argv[0]->i, argv[1]->i);
+      });
+
+  addServerMethod(
+      "/set/param/cut/duck_time", "if", [](lo_arg **argv, int argc) {
+        if (argc < 2) {
+          return;
+        }
+        Commands::softcutCommands.post(Commands::Id::SET_CUT_DUCK_TIME,
+                                       argv[0]->i, argv[1]->f);
+      });
+
   addServerMethod(
       "/set/param/cut/level_slew_time", "if", [](lo_arg **argv, int argc) {
         if (argc < 2) {
@@ -610,6 +700,37 @@ void OscInterface::addServerMethods() {
                                                argv[2]->f);
                   });
 
+  addServerMethod("/softcut/buffer/mips", "ii", [](lo_arg **argv, int argc) {
+    if (argc < 2) {
+      return;
+    }
+    softCutClient->setBufferMips(argv[0]->i, argv[1]->i != 0);
+  });
+
+  // replies with /softcut/buffer/memory for each buffer: channel, and bytes
+  // of address space reserved and of physical memory committed
+  addServerMethod("/softcut/buffer/memory", "", [](lo_arg **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    for (int i = 0; i < 2; ++i) {
+      lo_send(clientAddress, "/softcut/buffer/memory", "ihh", i,
+              static_cast<int64_t>(softCutClient->getBufferReservedBytes(i)),
+              static_cast<int64_t>(softCutClient->getBufferCommittedBytes(i)));
+    }
+  });
+
+  // replies with /softcut/commands: commands dropped because their lane
+  // was full, times commands were left waiting for a later period, and
+  // timed commands applied after their frame
+  addServerMethod("/softcut/commands", "", [](lo_arg **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    lo_send(clientAddress, "/softcut/commands", "iii",
+            static_cast<int>(softCutClient->getDroppedCommands()),
+            static_cast<int>(softCutClient->getDeferredCommands()),
+            static_cast<int>(softCutClient->getLateCommands()));
+  });
+
   addServerMethod("/softcut/reset", "", [](lo_arg **argv, int argc) {
     (void)argv;
     (void)argc;
@@ -618,9 +739,7 @@ void OscInterface::addServerMethods() {
     softCutClient->clearBuffer(1, 0, -1);
 
     softCutClient->reset();
-    for (int i = 0; i < SoftcutClient::NumVoices; ++i) {
-      phasePoll->stop();
-    }
+    phasePolling = false;
   });
 
   //---------------------
@@ -645,13 +764,26 @@ void OscInterface::addServerMethods() {
   addServerMethod("/poll/start/cut/phase", "", [](lo_arg **argv, int argc) {
     (void)argv;
     (void)argc;
-    phasePoll->start();
+    phasePolling = true;
   });
 
   addServerMethod("/poll/stop/cut/phase", "", [](lo_arg **argv, int argc) {
     (void)argv;
     (void)argc;
-    phasePoll->stop();
+    phasePolling = false;
+  });
+
+  // events are sent with voice, JACK frame time and value (see Event)
+  addServerMethod("/poll/start/cut/events", "", [](lo_arg **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    eventPolling = true;
+  });
+
+  addServerMethod("/poll/stop/cut/events", "", [](lo_arg **argv, int argc) {
+    (void)argv;
+    (void)argc;
+    eventPolling = false;
   });
 
   //--------------------------------
@@ -746,4 +878,10 @@ void OscInterface::printServerMethods() {
   }
 }
 
-void OscInterface::deinit() { lo_address_free(clientAddress); }
+void OscInterface::deinit() {
+  eventQuit = true;
+  if (eventThread.joinable()) {
+    eventThread.join();
+  }
+  lo_address_free(clientAddress);
+}
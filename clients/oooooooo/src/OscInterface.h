@@ -7,8 +7,10 @@
 #ifndef CRONE_OSCINTERFACE_H
 #define CRONE_OSCINTERFACE_H
 
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <lo/lo.h>
@@ -47,9 +49,16 @@ namespace softcut_jack_osc {
 
         static std::array<OscMethod, MaxNumMethods> methods;
         static std::unique_ptr<Poll> vuPoll;
-        static std::unique_ptr<Poll> phasePoll;
         static SoftcutClient *softCutClient;
 
+        // forwards events from the audio thread
+        static std::thread eventThread;
+        static std::atomic<bool> eventQuit;
+        // send quantized phase changes to /poll/softcut/phase
+        static std::atomic<bool> phasePolling;
+        // send all events to /event/cut/...
+        static std::atomic<bool> eventPolling;
+
     private:
         typedef void(*Handler)(lo_arg **argv, int argc);
         static void handleLoError(int num, const char *m, const char *path) {
@@ -64,6 +73,8 @@ namespace softcut_jack_osc {
 
         static void addServerMethods();
 
+        static void sendEvent(const Event &e);
+
 
     public:
         static void init(SoftcutClient *sc);
@@ -0,0 +1,39 @@
+/*
+ * timing of OSC messages from timetagged bundles.
+ *
+ * commands in a timetagged bundle are posted for the JACK frame its
+ * timetag falls on (see Commands::postAtFrame()), so the bundle has to be
+ * handled as soon as it arrives. liblo's servers hold timetagged bundles
+ * until their timetag by default; the frame would then be worked out a
+ * whole delay after it was due.
+ */
+
+#ifndef CRONE_OSCTIME_H
+#define CRONE_OSCTIME_H
+
+#include <lo/lo.h>
+
+namespace softcut_jack_osc {
+
+// hand bundles to the server's methods as they arrive, whatever their
+// timetag
+inline void dispatchOnArrival(lo_server_thread st) {
+  lo_server_enable_queue(lo_server_thread_get_server(st), 0, 1);
+}
+
+// seconds from now to the timetag of `msg`, negative if it has passed.
+// returns false if `msg` did not come in a timetagged bundle
+inline bool getSecondsUntil(lo_message msg, double &sec) {
+  const lo_timetag tt = lo_message_get_timestamp(msg);
+  if (tt.sec == 0 && tt.frac == 1) {
+    return false;
+  }
+  lo_timetag now;
+  lo_timetag_now(&now);
+  sec = lo_timetag_diff(tt, now);
+  return true;
+}
+
+}  // namespace softcut_jack_osc
+
+#endif  // CRONE_OSCTIME_H
@@ -24,8 +24,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
               if (v < 0.02f) {
                 v = 0.0f;
               }
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_LEVEL_CUT, voice, v));
+              Commands::softcutCommands.post(Commands::Id::SET_LEVEL_CUT, voice,
+                                             v);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 0)
@@ -42,8 +42,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             fclamp(default_value - 1.0f, -1.0f, 1.0f),
             fclamp(default_value + 1.0f, -1.0f, 1.0f), 0.1f, 12.0f, "pan", "",
             [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_PAN_CUT, voice, value));
+              Commands::softcutCommands.post(Commands::Id::SET_PAN_CUT, voice,
+                                             value);
             });
         break;
       case PARAM_LPF:
@@ -52,8 +52,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             sample_rate_, 20.0f, 135.0f, 0.1f, default_value, 125.0f, 140.0f,
             0.5f, random_lfo, "lpf", "", [this, voice](float value) {
               float freq = midi2freq(value);
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_POST_FILTER_FC, voice, freq));
+              Commands::softcutCommands.post(
+                  Commands::Id::SET_CUT_POST_FILTER_FC, voice, freq);
             });
         param_[i].SetStringFunc([](float value) {
           float freq = midi2freq(value);
@@ -70,8 +70,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             sample_rate_, -32.0, 36.0f, 0.1f, default_value,
             default_value - 6.0f, default_value + 6.0f, 0.5f, random_lfo,
             "pregain", "dB", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_TAPE_PREGAIN, voice, db2amp(value)));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_TAPE_PREGAIN,
+                                             voice, db2amp(value));
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 0)
@@ -86,8 +86,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             sample_rate_, -32.0, 12.0f, 0.1f, default_value,
             default_value - 6.0f, default_value + 6.0f, 0.5f, random_lfo,
             "bias", "dB", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_TAPE_BIAS, voice, db2amp(value)));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_TAPE_BIAS,
+                                             voice, db2amp(value));
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 0)
@@ -132,8 +132,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 2.0f, 0.01f, default_value, 0.99f, 1.01f, 0.1f,
             random_lfo, "rate", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_RATE, voice, value));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_RATE, voice,
+                                             value);
             });
         break;
       case PARAM_DIRECTION:
@@ -157,12 +157,12 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             default_value, 0.0f, 0.2f, 0.1f, random_lfo, "start", "s",
             [this, voice](float value) {
               float loop_duration = softCutClient_->getDuration(voice);
-              softCutClient_->handleCommand(new Commands::CommandPacket(
+              Commands::softcutCommands.post(
                   Commands::Id::SET_CUT_LOOP_START, voice,
-                  value + softCutClient_->getLoopMin(voice)));
-              softCutClient_->handleCommand(new Commands::CommandPacket(
+                  value + softCutClient_->getLoopMin(voice));
+              Commands::softcutCommands.post(
                   Commands::Id::SET_CUT_LOOP_END, voice,
-                  value + softCutClient_->getLoopMin(voice) + loop_duration));
+                  value + softCutClient_->getLoopMin(voice) + loop_duration);
             });
         break;
       case PARAM_DURATION:
@@ -172,8 +172,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             default_value - 1.0f, default_value + 1.0f, 0.1f, random_lfo,
             "duration", "", [this, voice](float value) {
               float start = softCutClient_->getLoopStart(voice);
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_LOOP_END, voice, value + start));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_LOOP_END,
+                                             voice, value + start);
             });
         param_[i].SetStringFunc([this, i](float value) {
           if (this->param_[i].IsQuantized()) {
@@ -198,8 +198,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
               if (value <= -42.0f) {
                 amp = 0.0f;
               }
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_REC_LEVEL, voice, amp));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_LEVEL,
+                                             voice, amp);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 0)
@@ -218,8 +218,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
               if (value <= -42.0f) {
                 amp = 0.0f;
               }
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_PRE_LEVEL, voice, amp));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_PRE_LEVEL,
+                                             voice, amp);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 0)
@@ -233,8 +233,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 4.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, "rec slew", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_RECPRE_SLEW_TIME, voice, value));
+              Commands::softcutCommands.post(
+                  Commands::Id::SET_CUT_RECPRE_SLEW_TIME, voice, value);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 1.0f)
@@ -248,8 +248,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 4.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, "level slew", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_LEVEL_SLEW_TIME, voice, value));
+              Commands::softcutCommands.post(
+                  Commands::Id::SET_CUT_LEVEL_SLEW_TIME, voice, value);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 1.0f)
@@ -263,8 +263,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 4.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, "rate slew", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_RATE_SLEW_TIME, voice, value));
+              Commands::softcutCommands.post(
+                  Commands::Id::SET_CUT_RATE_SLEW_TIME, voice, value);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 1.0f)
@@ -278,8 +278,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 4.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, "pan slew", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_PAN_SLEW_TIME, voice, value));
+              Commands::softcutCommands.post(
+                  Commands::Id::SET_CUT_PAN_SLEW_TIME, voice, value);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 1.0f)
@@ -293,8 +293,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(
             sample_rate_, 0.0, 4.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, "fade time", "", [this, voice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_CUT_FADE_TIME, voice, value));
+              Commands::softcutCommands.post(Commands::Id::SET_CUT_FADE_TIME,
+                                             voice, value);
             });
         param_[i].SetStringFunc([](float value) {
           if (value > 1.0f)
@@ -308,8 +308,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
         param_[i].Init(sample_rate_, 0.0, 1.0f, 0.01f, default_value, 0.0f,
                        1.0f, 0.1f, random_lfo, "mic input", "%",
                        [this, voice](float value) {
-                         softCutClient_->handleCommand(new Commands::CommandPacket(
-                             Commands::Id::SET_LEVEL_IN_CUT, 0, voice, value));
+                         Commands::softcutCommands.post(
+                             Commands::Id::SET_LEVEL_IN_CUT, 0, voice, value);
                        });
         param_[i].SetStringFunc([](float value) {
           return sprintf_str("%d", static_cast<int>(roundf(value * 100.0f)));
@@ -376,8 +376,8 @@ void Parameters::Init(SoftcutClient* sc, int voice, float sample_rate) {
             sample_rate_, 0.0, 1.0f, 0.01f, default_value, 0.0f, 1.0f, 0.1f,
             random_lfo, sprintf_str("loop %d input", srcVoice + 1), "%",
             [this, srcVoice, destVoice](float value) {
-              softCutClient_->handleCommand(new Commands::CommandPacket(
-                  Commands::Id::SET_LEVEL_CUT_CUT, srcVoice, destVoice, value));
+              Commands::softcutCommands.post(Commands::Id::SET_LEVEL_CUT_CUT,
+                                             srcVoice, destVoice, value);
             });
         param_[i].SetStringFunc([](float value) {
           return sprintf_str("%d", static_cast<int>(roundf(value * 100.0f)));
@@ -400,10 +400,13 @@ void Parameters::Update() {
   for (int i = 0; i < PARAM_COUNT; i++) {
     param_[i].Update();
   }
-  if (softCutClient_->IsDoneRecordingPrimed(voice_)) {
+}
+
+void Parameters::HandleEvent(const Event& e) {
+  if (e.type == Event::RecordStop && softCutClient_->WasPrimed(voice_)) {
     softCutClient_->SetWasPrimed(voice_, false);
-    // get position and start
-    float pos = softCutClient_->getSavedPosition(voice_);
+    // get position when recording stopped, and start
+    float pos = e.value;
     float loop_start = softCutClient_->getLoopStart(voice_);
     // set duration to pos - loop_start
     float duration = pos - loop_start - param_[PARAM_FADE_TIME].GetValue();
@@ -89,6 +89,8 @@ class Parameters : public Serializable {
   void UpdateFade();  // Add this method to update fade animation
 
   void Update();
+  // handle an event from the audio thread for this voice
+  void HandleEvent(const Event& e);
 
   void Bang() {
     for (int i = 0; i < PARAM_COUNT; i++) {
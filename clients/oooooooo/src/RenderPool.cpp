@@ -0,0 +1,188 @@
+#include "RenderPool.h"
+
+#include <jack/jack.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Futex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace softcut_jack_osc;
+
+// about 50us of polling before a worker goes to sleep
+static constexpr int SpinCount = 2000;
+// weight of the newest period in the smoothed load
+static constexpr float LoadSmoothing = 0.05f;
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// seconds elapsed since `t0`
+static inline double seconds(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+void RenderPool::start(int n, int rtPriority) {
+#ifdef __linux__
+  stop();
+  quit.store(false);
+  n = std::max(0, std::min(n, static_cast<int>(MaxWorkers)));
+  for (int i = 0; i < n; ++i) {
+    workers[i].go.store(0);
+    workers[i].claimed.store(0);
+    workers[i].done.store(0);
+    workers[i].thread = std::thread(&RenderPool::workLoop, this, i + 1);
+    if (rtPriority >= 0 &&
+        jack_acquire_real_time_scheduling(workers[i].thread.native_handle(),
+                                          rtPriority) != 0) {
+      std::cerr << "RenderPool: no realtime scheduling for worker " << i
+                << std::endl;
+    }
+  }
+  numWorkers.store(n, std::memory_order_release);
+#else
+  (void)n;
+  (void)rtPriority;
+#endif
+}
+
+void RenderPool::stop() {
+  const int n = numWorkers.exchange(0);
+  quit.store(true);
+  for (int i = 0; i < n; ++i) {
+    Worker &w = workers[i];
+    w.go.fetch_add(1);
+    wake(w);
+    w.thread.join();
+  }
+}
+
+void RenderPool::wake(Worker &w) {
+#ifdef __linux__
+  if (w.sleeping.load()) {
+    futexWake(&w.go);
+  }
+#else
+  (void)w;
+#endif
+}
+
+uint32_t RenderPool::waitForWork(Worker &w, uint32_t seen) {
+  for (int i = 0; i < SpinCount; ++i) {
+    const uint32_t gen = w.go.load(std::memory_order_acquire);
+    if (gen != seen) {
+      return gen;
+    }
+    cpuRelax();
+  }
+  while (true) {
+    // run() bumps `go` before checking `sleeping`, and we set `sleeping`
+    // before checking `go`, so one of us always sees the other
+    w.sleeping.store(true);
+    uint32_t gen = w.go.load();
+    if (gen == seen) {
+#ifdef __linux__
+      futexWait(&w.go, seen);
+#endif
+      gen = w.go.load(std::memory_order_acquire);
+    }
+    w.sleeping.store(false, std::memory_order_relaxed);
+    if (gen != seen) {
+      return gen;
+    }
+  }
+}
+
+void RenderPool::workLoop(int lane) {
+  Worker &w = workers[lane - 1];
+  uint32_t seen = w.go.load();
+  while (true) {
+    seen = waitForWork(w, seen);
+    if (quit.load(std::memory_order_acquire)) {
+      break;
+    }
+    // the caller may have taken this lane already
+    uint32_t expected = seen - 1;
+    if (!w.claimed.compare_exchange_strong(expected, seen)) {
+      continue;
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    task(ctx, lane);
+    w.elapsed = seconds(t0);
+    w.done.store(seen, std::memory_order_release);
+  }
+}
+
+void RenderPool::run(Task t, void *c, int numLanes, double periodSeconds) {
+  const int n = std::min(numLanes - 1, getNumWorkers());
+  task = t;
+  ctx = c;
+  for (int i = 0; i < n; ++i) {
+    Worker &w = workers[i];
+    w.go.fetch_add(1);
+    wake(w);
+  }
+
+  // lane 0, and any lanes without a worker
+  const auto t0 = std::chrono::steady_clock::now();
+  t(c, 0);
+  for (int lane = n + 1; lane < numLanes; ++lane) {
+    t(c, lane);
+  }
+  double callerElapsed = seconds(t0);
+
+  // take any lane whose worker has not started yet
+  bool taken[MaxWorkers] = {};
+  for (int i = 0; i < n; ++i) {
+    Worker &w = workers[i];
+    const uint32_t gen = w.go.load(std::memory_order_relaxed);
+    uint32_t expected = gen - 1;
+    if (w.claimed.compare_exchange_strong(expected, gen)) {
+      const auto t1 = std::chrono::steady_clock::now();
+      t(c, i + 1);
+      callerElapsed += seconds(t1);
+      w.done.store(gen, std::memory_order_relaxed);
+      taken[i] = true;
+    }
+  }
+  // and wait for the others
+  for (int i = 0; i < n; ++i) {
+    Worker &w = workers[i];
+    const uint32_t gen = w.go.load(std::memory_order_relaxed);
+    for (int spin = 0; w.done.load(std::memory_order_acquire) != gen;
+         ++spin) {
+      if (spin < SpinCount) {
+        cpuRelax();
+      } else {
+        // let the worker have this core, if it shares it with us
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  if (periodSeconds <= 0) {
+    return;
+  }
+  auto smooth = [&](int lane, double elapsed) {
+    const float x = static_cast<float>(elapsed / periodSeconds);
+    const float y = load[lane].load(std::memory_order_relaxed);
+    load[lane].store(y + (x - y) * LoadSmoothing, std::memory_order_relaxed);
+  };
+  // lanes taken back from workers count towards the calling thread
+  smooth(0, callerElapsed);
+  for (int lane = 1; lane < MaxLanes; ++lane) {
+    const bool ran = lane <= n && !taken[lane - 1];
+    smooth(lane, ran ? workers[lane - 1].elapsed : 0.0);
+  }
+}
@@ -0,0 +1,87 @@
+/*
+ * RenderPool shares the work of each audio period between the JACK process
+ * thread and a few realtime worker threads.
+ *
+ * run() renders lane 0 of a task on the calling thread and hands the other
+ * lanes to workers, then waits for them to finish. nothing is allocated and
+ * no locks are taken: workers spin briefly on a per-worker generation
+ * counter, then sleep on it with a futex until the next period wakes them.
+ * a lane is claimed by whichever thread gets to it first, so the caller
+ * renders any lane whose worker has not woken up by the time it is free,
+ * and never waits on a worker that is not running.
+ * workers need futexes, so on other platforms the pool has no workers and
+ * every lane is rendered on the calling thread.
+ */
+
+#ifndef CRONE_RENDERPOOL_H
+#define CRONE_RENDERPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace softcut_jack_osc {
+
+class RenderPool {
+ public:
+  enum { MaxWorkers = 7 };
+  enum { MaxLanes = MaxWorkers + 1 };
+  // render one lane of a task
+  typedef void (*Task)(void *ctx, int lane);
+
+  RenderPool() = default;
+  ~RenderPool() { stop(); }
+  RenderPool(const RenderPool &) = delete;
+  RenderPool &operator=(const RenderPool &) = delete;
+
+  // start up to `numWorkers` threads, at the given realtime priority if
+  // `rtPriority` is not negative. call from a non-audio thread.
+  void start(int numWorkers, int rtPriority);
+  void stop();
+
+  int getNumWorkers() const {
+    return numWorkers.load(std::memory_order_acquire);
+  }
+
+  // run `task` for lanes [0, numLanes) and wait for all of them.
+  // lanes beyond the number of workers run on the calling thread.
+  // `periodSeconds` is the duration of audio rendered, for load reporting.
+  void run(Task task, void *ctx, int numLanes, double periodSeconds);
+
+  // smoothed fraction of the period spent rendering, per lane.
+  // lane 0 is the calling (JACK) thread
+  float getLoad(int lane) const {
+    return load[lane].load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct alignas(64) Worker {
+    // bumped by run() for each task; futex word
+    std::atomic<uint32_t> go{0};
+    // set to the value of `go` by the thread that takes the lane
+    std::atomic<uint32_t> claimed{0};
+    // set to the value of `go` once the lane is finished
+    std::atomic<uint32_t> done{0};
+    // set while the worker is (about to be) waiting on the futex
+    std::atomic<bool> sleeping{false};
+    // time the worker spent on its last lane
+    double elapsed = 0;
+    std::thread thread;
+  };
+
+  void workLoop(int lane);
+  uint32_t waitForWork(Worker &w, uint32_t seen);
+  static void wake(Worker &w);
+
+  Worker workers[MaxWorkers];
+  std::atomic<int> numWorkers{0};
+  std::atomic<bool> quit{false};
+  // current task; written before `go` is bumped
+  Task task = nullptr;
+  void *ctx = nullptr;
+  std::atomic<float> load[MaxLanes] = {};
+};
+
+}  // namespace softcut_jack_osc
+
+#endif  // CRONE_RENDERPOOL_H
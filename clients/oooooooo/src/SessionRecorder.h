@@ -9,8 +9,10 @@
 #include <thread>
 #include <vector>
 
-// Use double as sample type to match softcut
-using sample_t = double;
+#include "softcut/Types.h"
+
+// sample type matches softcut
+using softcut::sample_t;
 
 class SessionRecorder {
  public:
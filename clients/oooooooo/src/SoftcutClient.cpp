@@ -6,11 +6,23 @@
 
 #include <sndfile.hh>
 
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
 #include "BufDiskWorker.h"
 #include "Commands.h"
 
 using namespace softcut_jack_osc;
 
+static_assert(static_cast<int>(Event::LoopWrap) ==
+                      softcut::VoiceEvent::LoopWrap &&
+                  static_cast<int>(Event::QuantPhase) ==
+                      softcut::VoiceEvent::QuantPhase &&
+                  static_cast<int>(Event::RecOnceDone) ==
+                      softcut::VoiceEvent::RecOnceDone,
+              "voice events pass through as client events");
+
 // clamp unsigned int to upper bound, inclusive
 static inline void clamp(size_t &x, const size_t a) {
   if (x > a) {
@@ -18,13 +30,46 @@ static inline void clamp(size_t &x, const size_t a) {
   }
 }
 
+// run the reverb in place on a stereo bus
+static inline void processReverb(FVerb &reverb, float *l, float *r,
+                                 size_t numFrames) {
+  float *inOut[2] = {l, r};
+  reverb.Process(inOut, numFrames);
+}
+
+// the reverb processes float, so double busses are converted
+static inline void processReverb(FVerb &reverb, double *l, double *r,
+                                 size_t numFrames) {
+  float reverbFloat[2][SoftcutClient::MaxBlockFrames];
+  for (size_t i = 0; i < numFrames; i++) {
+    reverbFloat[0][i] = static_cast<float>(l[i]);
+    reverbFloat[1][i] = static_cast<float>(r[i]);
+  }
+  processReverb(reverb, reverbFloat[0], reverbFloat[1], numFrames);
+  for (size_t i = 0; i < numFrames; i++) {
+    l[i] = static_cast<double>(reverbFloat[0][i]);
+    r[i] = static_cast<double>(reverbFloat[1][i]);
+  }
+}
+
 float SoftcutClient::getLoopDuration() {
   float totalSeconds = static_cast<float>(BufFrames) / sampleRate;
   float cutDuration = totalSeconds / static_cast<float>(NumVoices / 2);
   return cutDuration;
 }
 
+// call before start(): voice state is set directly, not through the queue
 void SoftcutClient::init() {
+  // render threads: as many as there are spare cores, within limits
+  const int cores = static_cast<int>(std::thread::hardware_concurrency());
+  const int numWorkers =
+      std::max(0, std::min(cores - 1, static_cast<int>(MaxRenderWorkers)));
+  renderPool.start(numWorkers, jack_is_realtime(client)
+                                   ? jack_client_real_time_priority(client)
+                                   : -1);
+  std::cerr << "SoftcutClient: " << numWorkers + 1 << " render threads"
+            << std::endl;
+
   // set each loop to be 2 seconds long, equally spaced across the buffer
   // initialize seed
   float cutDuration = getLoopDuration();
@@ -36,6 +81,7 @@ void SoftcutClient::init() {
     vuMeters[i].setAttackTime(0.001f);
     vuMeters[i].setDecayTime(0.002f);
     isPrimed[i] = false;
+    recording[i] = false;
     blockRMS[i] = 0.0f;
     rateForward[i] = true;
     loopMin[i] = cutDuration * static_cast<float>(i);
@@ -44,51 +90,40 @@ void SoftcutClient::init() {
     }
 
     // enable
-    SoftcutClient::handleCommand(
-        new Commands::CommandPacket(Commands::Id::SET_ENABLED_CUT, i, 1.0f));
+    applyCommand(Commands::Id::SET_ENABLED_CUT, i, 1.0f);
     // set buffer to 0/1
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_BUFFER, i, i < 4 ? 0 : 1));
+    applyCommand(Commands::Id::SET_CUT_BUFFER, i, i < 4 ? 0 : 1);
 
     // set post filter dry to 0
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_POST_FILTER_DRY, i, 0.0f));
+    applyCommand(Commands::Id::SET_CUT_POST_FILTER_DRY, i, 0.0f);
 
     // set lp filter to 1
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_POST_FILTER_LP, i, 1.0f));
+    applyCommand(Commands::Id::SET_CUT_POST_FILTER_LP, i, 1.0f);
 
     // set lp fc to 19kHz
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_POST_FILTER_FC, i, 19000.0f));
+    applyCommand(Commands::Id::SET_CUT_POST_FILTER_FC, i, 19000.0f);
 
     // set pan to  random number between -0.25 and 0.25
     float pan =
         (static_cast<float>(rand()) / RAND_MAX) * 1.25f - (1.25f / 2.0f);
-    SoftcutClient::handleCommand(
-        new Commands::CommandPacket(Commands::Id::SET_PAN_CUT, i, pan));
+    applyCommand(Commands::Id::SET_PAN_CUT, i, pan);
     // set loop to on
-    SoftcutClient::handleCommand(
-        new Commands::CommandPacket(Commands::Id::SET_CUT_LOOP_FLAG, i, 1.0f));
+    applyCommand(Commands::Id::SET_CUT_LOOP_FLAG, i, 1.0f);
 
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_LOOP_START, i, loopMin[i]));
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_LOOP_END, i, loopMin[i] + 2.0f));
+    applyCommand(Commands::Id::SET_CUT_LOOP_START, i, loopMin[i]);
+    applyCommand(Commands::Id::SET_CUT_LOOP_END, i, loopMin[i] + 2.0f);
 
     // set play flag on
-    SoftcutClient::handleCommand(
-        new Commands::CommandPacket(Commands::Id::SET_CUT_PLAY_FLAG, i, 0.0f));
+    applyCommand(Commands::Id::SET_CUT_PLAY_FLAG, i, 0.0f);
 
     // cut to the beginning
-    SoftcutClient::handleCommand(new Commands::CommandPacket(
-        Commands::Id::SET_CUT_POSITION, i, loopMin[i]));
+    applyCommand(Commands::Id::SET_CUT_POSITION, i, loopMin[i]);
   }
 }
 
 SoftcutClient::SoftcutClient() : JackClient<2, 2>("softcut") {
   for (unsigned int i = 0; i < NumVoices; ++i) {
-    cut.setVoiceBuffer(i, buf[i & 1], BufFrames);
+    setVoiceBuffer(i, i & 1);
 
     // Initialize reverb send levels
     reverbSend[i].setTarget(0.0f);
@@ -101,26 +136,68 @@ SoftcutClient::SoftcutClient() : JackClient<2, 2>("softcut") {
   reverbEnabled = false;
 
   for (unsigned int i = 0; i < NumVoices; ++i) {
-    cut.setVoiceBuffer(i, buf[i & 1], BufFrames);
+    setVoiceBuffer(i, i & 1);
   }
-  bufIdx[0] = BufDiskWorker::registerBuffer(buf[0], BufFrames);
-  bufIdx[1] = BufDiskWorker::registerBuffer(buf[1], BufFrames);
+  bufIdx[0] = BufDiskWorker::registerBuffer(buf[0]);
+  bufIdx[1] = BufDiskWorker::registerBuffer(buf[1]);
 }
 
 void SoftcutClient::process(jack_nframes_t numFrames) {
-  Commands::softcutCommands.handlePending(this);
+  const uint32_t frameTime = jack_last_frame_time(client);
+  // shared by every handlePending() call this period
+  int budget = Commands::MaxPerPeriod;
+  // the same block size whatever the period, so bus and voice state
+  // stays in cache, and long periods don't need long busses
+  const int periodFrames = static_cast<int>(numFrames);
+  int splits = 0;
+  for (int offset = 0; offset < periodFrames; offset += MaxBlockFrames) {
+    // commands, then parameters, once per block
+    Commands::softcutCommands.handlePending(this, frameTime + offset, budget);
+    Commands::softcutCommands.handleParams(this);
+    const int n = std::min(periodFrames - offset, +MaxBlockFrames);
+    processBlock(frameTime + offset, offset, n, splits, budget);
+  }
+  oscEvents.notify();
+}
+
+void SoftcutClient::processBlock(uint32_t frameTime, int offset,
+                                 int numFrames, int &splits, int &budget) {
   clearBusses(numFrames);
-  mixInput(numFrames);
-  // process softcuts (overwrites output bus)
+  mixInput(offset, numFrames);
+  // process softcuts (overwrites output bus).
+  // feedback was mixed from output a block ago above,
+  // so voices only depend on each other through shared buffers
+  for (auto &b : buf) {
+    b.syncMips();
+  }
   for (int v = 0; v < NumVoices; ++v) {
+    cut.setVoiceMipmap(v, buf[voiceBuf[v]].mips());
     vuMeters[v].process(input[v].buf[0], numFrames);
-    if (enabled[v]) {
-      cut.processBlock(v, input[v].buf[0], output[v].buf[0],
-                       static_cast<int>(numFrames));
+    played[v] = false;
+  }
+  // split the block where timed commands fall due, and apply them there
+  int start = 0;
+  for (;; ++splits) {
+    int end = numFrames;
+    uint32_t due;
+    if (splits < MaxSplits && Commands::softcutCommands.getNextFrame(due)) {
+      const auto at = static_cast<int32_t>(due - frameTime);
+      if (at > start && at < end) {
+        end = at;
+      }
     }
+    renderVoices(start, end - start);
+    if (end == numFrames) {
+      break;
+    }
+    postEvents(frameTime + start);
+    start = end;
+    Commands::softcutCommands.handlePending(this, frameTime + start, budget);
+  }
+  for (int v = 0; v < NumVoices; ++v) {
     // compute blockRMS
     sample_t rms = 0;
-    for (size_t i = 0; i < numFrames; i++) {
+    for (int i = 0; i < numFrames; i++) {
       rms += input[v].buf[0][i] * input[v].buf[0][i];
     }
     rms = sqrt(rms / static_cast<float>(numFrames));
@@ -129,16 +206,13 @@ void SoftcutClient::process(jack_nframes_t numFrames) {
                 << " sensitivity: " << primeSensitivity[v] << std::endl;
     }
     if (amp2db(rms) > primeSensitivity[v] && isPrimed[v]) {
-      if (isPrimedToRecordOnce[v]) {
-        ToggleRecordOnce(v);
-        isPrimedToRecordOnce[v] = false;
-        isPrimed[v] = false;
-      } else {
-        ToggleRecord(v, true);
-      }
+      postEvent({Event::PrimeTrigger, v, frameTime, 0.f});
+      recordPrimed(v);
     }
     blockRMS[v] = rms;
   }
+  postEvents(frameTime + start);
+  pushFeedback(numFrames);
   mixOutput(numFrames);
 
   // Capture audio for session recording
@@ -148,14 +222,141 @@ void SoftcutClient::process(jack_nframes_t numFrames) {
 
     // Capture individual voices (stereo, after panning and level adjustment)
     for (int v = 0; v < NumVoices; ++v) {
-      if (cut.getPlayFlag(v)) {
+      if (played[v]) {
         sessionRecorder_.captureVoice(v, voiceOutputBus[v].buf[0],
                                       voiceOutputBus[v].buf[1], numFrames);
       }
     }
   }
 
-  mix.copyTo(sink[0], numFrames);
+  float *dac[2] = {sink[0][0] + offset, sink[0][1] + offset};
+  mix.copyTo(dac, numFrames);
+}
+
+void SoftcutClient::renderVoices(int offset, int numFrames) {
+  for (int v = 0; v < NumVoices; ++v) {
+    voiceIn[v] = input[v].buf[0] + offset;
+    voiceOut[v] = output[v].buf[0] + offset;
+  }
+  renderFrames = numFrames;
+  const int numLanes = scheduleVoices(renderFrames);
+  // where voices record, for buffers whose mip levels are being built
+  softcut::phase_t lo[NumVoices], hi[NumVoices];
+  bool wrote[NumVoices];
+  for (int v = 0; v < NumVoices; ++v) {
+    wrote[v] = rendered[v] && cut.getWriteSpan(v, numFrames, lo[v], hi[v]);
+  }
+  if (numLanes > 0) {
+    renderPool.run(&SoftcutClient::renderLane, this, numLanes,
+                   static_cast<double>(numFrames) / sampleRate);
+  }
+  for (int v = 0; v < NumVoices; ++v) {
+    LoopBuffer &b = buf[voiceBuf[v]];
+    if (wrote[v] && b.mipsBuilding()) {
+      b.markWritten(static_cast<long>(std::floor(lo[v])),
+                    static_cast<long>(std::ceil(hi[v])));
+    }
+  }
+  for (int v = 0; v < NumVoices; ++v) {
+    // flags only change between renders. a voice left out of this render
+    // has nothing new in its output
+    if (!rendered[v]) {
+      std::fill_n(voiceOut[v], numFrames, static_cast<sample_t>(0));
+    }
+    played[v] = played[v] || (rendered[v] && cut.getPlayFlag(v));
+  }
+}
+
+int SoftcutClient::scheduleVoices(int numFrames) {
+  int group[NumVoices];
+  const int numGroups = cut.groupVoices(enabled, numFrames, group);
+  const int numLanes = std::min(numGroups, renderPool.getNumWorkers() + 1);
+  int size[NumVoices] = {};
+  for (int v = 0; v < NumVoices; ++v) {
+    if (group[v] >= 0) {
+      ++size[group[v]];
+    }
+  }
+  // largest groups first, each to the thread with the fewest voices
+  int order[NumVoices];
+  for (int k = 0; k < numGroups; ++k) {
+    order[k] = k;
+  }
+  std::sort(order, order + numGroups,
+            [&](int a, int b) { return size[a] > size[b]; });
+  int laneOf[NumVoices];
+  int laneSize[RenderPool::MaxLanes] = {};
+  for (int k = 0; k < numGroups; ++k) {
+    const int g = order[k];
+    int lane = 0;
+    for (int i = 1; i < numLanes; ++i) {
+      if (laneSize[i] < laneSize[lane]) {
+        lane = i;
+      }
+    }
+    laneOf[g] = lane;
+    laneSize[lane] += size[g];
+  }
+  for (int lane = 0; lane < numLanes; ++lane) {
+    for (int v = 0; v < NumVoices; ++v) {
+      laneVoices[lane][v] = group[v] >= 0 && laneOf[group[v]] == lane;
+    }
+  }
+  for (int v = 0; v < NumVoices; ++v) {
+    rendered[v] = group[v] >= 0;
+  }
+  return numLanes;
+}
+
+void SoftcutClient::postEvents(uint32_t frameTime) {
+  for (int v = 0; v < NumVoices; ++v) {
+    // a rec-once pass ends at a known frame; other stops take effect
+    // at the start of the render
+    uint32_t recStopFrame = frameTime;
+    for (int k = 0; rendered[v] && k < cut.getNumEvents(v); ++k) {
+      const softcut::VoiceEvent &e = cut.getEvent(v, k);
+      const uint32_t frame = frameTime + static_cast<uint32_t>(e.frame);
+      if (e.type == softcut::VoiceEvent::RecOnceDone) {
+        recStopFrame = frame;
+      }
+      postEvent({static_cast<Event::Type>(e.type), v, frame,
+                 static_cast<float>(e.value)});
+    }
+    const bool rec = cut.getRecFlag(v);
+    if (recording[v] && !rec) {
+      postEvent(
+          {Event::RecordStop, v, recStopFrame, cut.getSavedPosition(v)});
+    }
+    recording[v] = rec;
+  }
+}
+
+void SoftcutClient::postEvent(const Event &e) {
+  oscEvents.push(e);
+  if (e.type != Event::QuantPhase) {
+    uiEvents.push(e);
+  }
+}
+
+void SoftcutClient::renderLane(void *ctx, int lane) {
+  auto *self = static_cast<SoftcutClient *>(ctx);
+  self->cut.processBlocks(self->voiceIn, self->voiceOut,
+                          self->laneVoices[lane], self->renderFrames);
+}
+
+void SoftcutClient::setBufferSize(jack_nframes_t numFrames) {
+  const auto blocks = (numFrames + MaxBlockFrames - 1) / MaxBlockFrames;
+  std::cerr << "SoftcutClient::setBufferSize: " << numFrames << " ("
+            << blocks << " blocks)" << std::endl;
+  // nothing here is sized by the period: busses hold one block, feedback
+  // goes by frames, and the render pool runs once per block and split
+  // whatever the period. splits are shared by the whole period though, so
+  // a long one has fewer per block
+  if (blocks > MaxSplits) {
+    std::cerr << "SoftcutClient: more blocks per period than splits ("
+              << MaxSplits << "); timed commands may be applied late"
+              << std::endl;
+  }
 }
 
 void SoftcutClient::setSampleRate(jack_nframes_t sr) {
@@ -177,21 +378,32 @@ void SoftcutClient::clearBusses(size_t numFrames) {
   }
 }
 
-void SoftcutClient::mixInput(size_t numFrames) {
+void SoftcutClient::mixInput(size_t offset, size_t numFrames) {
+  const float *adc[2] = {source[SourceAdc][0] + offset,
+                         source[SourceAdc][1] + offset};
   for (int dst = 0; dst < NumVoices; ++dst) {
     if (cut.getRecFlag(dst) || true) {
       for (int ch = 0; ch < 2; ++ch) {
-        input[dst].mixFrom(&source[SourceAdc][ch], numFrames, inLevel[ch][dst]);
+        input[dst].mixFrom(&adc[ch], numFrames, inLevel[ch][dst]);
       }
       for (int src = 0; src < NumVoices; ++src) {
         if (cut.getPlayFlag(src)) {
-          input[dst].mixFrom(output[src], numFrames, fbLevel[src][dst]);
+          input[dst].mixFrom(feedback[src], numFrames, fbLevel[src][dst]);
         }
       }
     }
   }
 }
 
+void SoftcutClient::pushFeedback(size_t numFrames) {
+  const size_t kept = MaxBlockFrames - numFrames;
+  for (int v = 0; v < NumVoices; ++v) {
+    sample_t *h = feedback[v].buf[0];
+    std::copy(h + numFrames, h + MaxBlockFrames, h);
+    std::copy(output[v].buf[0], output[v].buf[0] + numFrames, h + kept);
+  }
+}
+
 void SoftcutClient::mixOutput(size_t numFrames) {
   reverbBus.clear(numFrames);
 
@@ -199,7 +411,7 @@ void SoftcutClient::mixOutput(size_t numFrames) {
   for (int v = 0; v < NumVoices; ++v) {
     voiceOutputBus[v].clear(numFrames);
 
-    if (cut.getPlayFlag(v)) {
+    if (played[v]) {
       // Pan this voice into its own stereo bus
       voiceOutputBus[v].panMixEpFrom(output[v], numFrames, outLevel[v], outPan[v]);
 
@@ -212,20 +424,7 @@ void SoftcutClient::mixOutput(size_t numFrames) {
   }
 
   if (reverbEnabled) {
-    float reverbFloat[2][MaxBlockFrames];
-    for (size_t ch = 0; ch < 2; ch++) {
-      for (size_t i = 0; i < numFrames; i++) {
-        reverbFloat[ch][i] = static_cast<float>(reverbBus.buf[ch][i]);
-      }
-    }
-    float *reverbInOut[2] = {reverbFloat[0], reverbFloat[1]};
-    reverb.Process(reverbInOut, numFrames);
-    // Convert back to double
-    for (size_t ch = 0; ch < 2; ch++) {
-      for (size_t i = 0; i < numFrames; i++) {
-        reverbBus.buf[ch][i] = static_cast<sample_t>(reverbFloat[ch][i]);
-      }
-    }
+    processReverb(reverb, reverbBus.buf[0], reverbBus.buf[1], numFrames);
     // Mix the processed reverb into the main output
     mix.addFrom(reverbBus, numFrames);
   }
@@ -266,6 +465,12 @@ void SoftcutClient::handleCommand(Commands::CommandPacket *p) {
     case Commands::Id::SET_CUT_FADE_TIME:
       cut.setFadeTime(p->idx_0, p->value);
       break;
+    case Commands::Id::SET_CUT_FADE_SHAPE:
+      cut.setFadeShape(p->idx_0, p->idx_1);
+      break;
+    case Commands::Id::SET_CUT_INTERPOLATION:
+      cut.setInterpolation(p->idx_0, p->idx_1);
+      break;
     case Commands::Id::SET_CUT_REC_LEVEL:
       cut.setRecLevel(p->idx_0, p->value);
       break;
@@ -275,6 +480,9 @@ void SoftcutClient::handleCommand(Commands::CommandPacket *p) {
     case Commands::Id::SET_CUT_REC_FLAG:
       cut.setRecFlag(p->idx_0, p->value > 0.f);
       break;
+    case Commands::Id::SET_CUT_REC_ONCE:
+      cut.setRecOnceFlag(p->idx_0, p->value > 0.f);
+      break;
     case Commands::Id::SET_CUT_PLAY_FLAG:
       cut.setPlayFlag(p->idx_0, p->value > 0.f);
       break;
@@ -347,8 +555,17 @@ void SoftcutClient::handleCommand(Commands::CommandPacket *p) {
     case Commands::Id::SET_CUT_VOICE_SYNC:
       cut.syncVoice(p->idx_0, p->idx_1, p->value);
       break;
+    case Commands::Id::SET_CUT_VOICE_FOLLOW:
+      cut.setFollow(p->idx_0, p->idx_1);
+      break;
+    case Commands::Id::SET_CUT_VOICE_DUCK:
+      cut.setDuck(p->idx_0, p->idx_1);
+      break;
+    case Commands::Id::SET_CUT_DUCK_TIME:
+      cut.setDuckTime(p->idx_0, p->value);
+      break;
     case Commands::Id::SET_CUT_BUFFER:
-      cut.setVoiceBuffer(p->idx_0, buf[p->idx_1], BufFrames);
+      setVoiceBuffer(p->idx_0, p->idx_1);
       break;
     case Commands::Id::SET_CUT_TAPE_BIAS:
       cut.setTapeBias(p->idx_0, p->value);
@@ -356,14 +573,72 @@ void SoftcutClient::handleCommand(Commands::CommandPacket *p) {
     case Commands::Id::SET_CUT_TAPE_PREGAIN:
       cut.setTapePregain(p->idx_0, p->value);
       break;
+    case Commands::Id::SET_CUT_BASE_RATE:
+      rateBase[p->idx_0] = p->value;
+      updateRate(p->idx_0);
+      break;
+    case Commands::Id::SET_CUT_RATE_DIRECTION:
+      rateForward[p->idx_0] = p->value > 0.f;
+      updateRate(p->idx_0);
+      break;
+    case Commands::Id::SET_CUT_PHASE_QUANT:
+      cut.setPhaseQuant(p->idx_0, p->value);
+      break;
+    case Commands::Id::SET_CUT_PHASE_OFFSET:
+      cut.setPhaseOffset(p->idx_0, p->value);
+      break;
+      //-- reverb
+    case Commands::Id::SET_REVERB_ENABLED:
+      reverbEnabled = p->value > 0.f;
+      break;
+    case Commands::Id::SET_REVERB_MIX:
+      reverbMix.setTarget(p->value);
+      break;
+    case Commands::Id::SET_REVERB_SEND:
+      reverbSend[p->idx_0].setTarget(p->value);
+      break;
+    case Commands::Id::SET_REVERB_DECAY:
+      reverb.SetDecay(p->value);
+      break;
+    case Commands::Id::SET_REVERB_TAIL_DENSITY:
+      reverb.SetTailDensity(p->value);
+      break;
+    case Commands::Id::SET_REVERB_INPUT_DIFFUSION_1:
+      reverb.SetInputDiffision1(p->value);
+      break;
+    case Commands::Id::SET_REVERB_INPUT_DIFFUSION_2:
+      reverb.SetInputDiffision2(p->value);
+      break;
+    case Commands::Id::RESET:
+      applyReset();
+      break;
     default:;
       ;
   }
 }
 
-void SoftcutClient::reset() {
+void SoftcutClient::recordPrimed(int i) {
+  if (isPrimedToRecordOnce[i]) {
+    if (!cut.getRecFlag(i)) {
+      applyCommand(Commands::Id::SET_CUT_PLAY_FLAG, i, 1.f);
+      applyCommand(Commands::Id::SET_CUT_POSITION, i, getLoopStart(i));
+      applyCommand(Commands::Id::SET_CUT_REC_ONCE, i, 1.f);
+    } else {
+      applyCommand(Commands::Id::SET_CUT_REC_FLAG, i, 0.f);
+    }
+    isPrimedToRecordOnce[i] = false;
+    isPrimed[i] = false;
+  } else {
+    applyCommand(Commands::Id::SET_CUT_PLAY_FLAG, i, 1.f);
+    applyCommand(Commands::Id::SET_CUT_REC_FLAG, i, 1.f);
+    wasPrimed[i] = true;
+    isPrimed[i] = false;
+  }
+}
+
+void SoftcutClient::applyReset() {
   for (int v = 0; v < NumVoices; ++v) {
-    cut.setVoiceBuffer(v, buf[v % 2], BufFrames);
+    setVoiceBuffer(v, v % 2);
     outLevel[v].setTarget(0.f);
     outLevel->setTime(0.001);
     outPan[v].setTarget(0.5f);
@@ -375,8 +650,8 @@ void SoftcutClient::reset() {
 
     enabled[v] = false;
 
-    setPhaseQuant(v, 1.f);
-    setPhaseOffset(v, 0.f);
+    cut.setPhaseQuant(v, 1.f);
+    cut.setPhaseOffset(v, 0.f);
 
     for (int i = 0; i < 2; ++i) {
       inLevel[i][v].setTime(0.001);
@@ -392,6 +667,7 @@ void SoftcutClient::reset() {
     cut.setLoopEnd(v, v * 2 + 1);
 
     output[v].clear();
+    feedback[v].clear();
     input[v].clear();
   }
 
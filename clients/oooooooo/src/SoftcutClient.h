@@ -10,7 +10,10 @@
 
 #include "BufDiskWorker.h"
 #include "Bus.h"
+#include "EventRing.h"
 #include "JackClient.h"
+#include "LoopBuffer.h"
+#include "RenderPool.h"
 #include "SessionRecorder.h"
 #include "Utilities.h"
 #include "VUMeter.h"
@@ -21,13 +24,22 @@
 namespace softcut_jack_osc {
 class SoftcutClient : public JackClient<2, 2> {
  public:
-  enum { MaxBlockFrames = 2048 };
-  // >2^24 as long as sample_t is double,
-  // otherwise 2^24
+  // frames processed at once. periods of any size are processed as a
+  // run of blocks of at most this many frames
+  enum { MaxBlockFrames = 256 };
+  // can exceed 2^24 since phase is double, even with float samples.
+  // 2 GiB of buffer memory with double samples, 1 GiB with float
   enum {
     BufFrames = 134217728
   };  // 2^27, ~6 minutes of mono audio at 48kHz per loop
-  enum { NumVoices = 8 };
+  // as many as commands are checked against
+  enum { NumVoices = Commands::NumVoices };
+  // render threads besides the JACK thread, at most
+  enum { MaxRenderWorkers = 3 };
+  // extra renders for timed commands in a period, at most;
+  // commands due after the last split wait for the next block, and are
+  // counted as late
+  enum { MaxSplits = 32 };
   typedef enum { SourceAdc = 0 } SourceId;
   typedef Bus<2, MaxBlockFrames> StereoBus;
   typedef Bus<1, MaxBlockFrames> MonoBus;
@@ -45,46 +57,45 @@ class SoftcutClient : public JackClient<2, 2> {
   float getLoopEnd(int i) { return cut.getLoopEnd(i); }
   float getPreGain(int i) { return cut.getPreGain(i); }
   float getRate(int i) { return rateSet[i]; }
+  // setters that change what the audio thread renders post to the
+  // commands queue; don't call them from the audio thread
   void setBaseRate(int i, float rate) {
-    rateBase[i] = rate;
-    updateRate(i);
+    Commands::softcutCommands.post(Commands::Id::SET_CUT_BASE_RATE, i, rate);
   }
   void setRateDirection(int i, bool forward) {
-    rateForward[i] = forward;
-    updateRate(i);
-  }
-  void updateRate(int i) {
-    cut.setRate(i, rateSet[i] * rateBase[i] * (rateForward[i] ? 1.f : -1.f));
+    Commands::softcutCommands.post(Commands::Id::SET_CUT_RATE_DIRECTION, i,
+                                   forward ? 1.f : 0.f);
   }
   bool IsRecording(int i) { return cut.getRecFlag(i); }
   bool IsPlaying(int i) { return cut.getPlayFlag(i); }
   void ToggleRecord(int i) { ToggleRecord(i, !IsRecording(i)); }
   void ToggleRecord(int i, bool rec) {
     if (rec) {
-      cut.setPlayFlag(i, true);
-      cut.setRecFlag(i, true);
+      prefaultLoop(i);
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_PLAY_FLAG, i, 1.f);
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_FLAG, i, 1.f);
       if (isPrimed[i]) {
         wasPrimed[i] = true;
         isPrimed[i] = false;
       }
     } else {
-      cut.setRecFlag(i, false);
-      doneRecordingPrimed[i] = wasPrimed[i];
-      if (wasPrimed[i]) {
-        doneRecordingPrimed[i] = true;
-      }
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_FLAG, i, 0.f);
     }
   }
   void TogglePrime(int i) {
     wasPrimed[i] = false;
-    doneRecordingPrimed[i] = false;
     isPrimed[i] = !isPrimed[i];
+    if (isPrimed[i]) {
+      prefaultLoop(i);
+    }
   }
   void TogglePrimeToRecordOnce(int i) {
     wasPrimed[i] = false;
-    doneRecordingPrimed[i] = false;
     isPrimed[i] = !isPrimed[i];
     isPrimedToRecordOnce[i] = isPrimed[i];
+    if (isPrimed[i]) {
+      prefaultLoop(i);
+    }
   }
   bool IsPrimed(int i) { return isPrimed[i]; }
   bool IsPrimedToRecordOnce(int i) {
@@ -92,31 +103,27 @@ class SoftcutClient : public JackClient<2, 2> {
   }
   bool WasPrimed(int i) { return wasPrimed[i]; }
   void SetWasPrimed(int i, bool was) { wasPrimed[i] = was; }
-  bool IsDoneRecordingPrimed(int i) {
-    if (doneRecordingPrimed[i]) {
-      doneRecordingPrimed[i] = false;
-      return true;
-    }
-    return false;
-  }
   void ToggleRecordOnce(int i) {
     if (!IsRecording(i)) {
-      cut.setPlayFlag(i, true);
+      prefaultLoop(i);
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_PLAY_FLAG, i, 1.f);
       float pos = getLoopStart(i);
       Commands::softcutCommands.post(Commands::Id::SET_CUT_POSITION, i, pos);
-      cut.setRecOnceFlag(i, true);
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_ONCE, i, 1.f);
     } else {
-      cut.setRecFlag(i, false);
+      Commands::softcutCommands.post(Commands::Id::SET_CUT_REC_FLAG, i, 0.f);
     }
   }
   void TogglePlay(int i) {
-    cut.setPlayFlag(i, !IsPlaying(i));
+    TogglePlay(i, !IsPlaying(i));
     isPrimed[i] = false;
     isPrimedToRecordOnce[i] = false;
     wasPrimed[i] = false;
-    doneRecordingPrimed[i] = false;
   }
-  void TogglePlay(int i, bool play) { cut.setPlayFlag(i, play); }
+  void TogglePlay(int i, bool play) {
+    Commands::softcutCommands.post(Commands::Id::SET_CUT_PLAY_FLAG, i,
+                                   play ? 1.f : 0.f);
+  }
   float getVULevel(int voice) const {
     if (voice >= 0 && voice < NumVoices) {
       return vuMeters[voice].getLevel();
@@ -124,6 +131,49 @@ class SoftcutClient : public JackClient<2, 2> {
     return -100.0f;  // Return silence for invalid voice
   }
   float getCPUUsage() { return static_cast<float>(jack_cpu_load(client)); }
+  // JACK frame `sec` seconds from now, plus one period, for timed
+  // commands (see Commands::postAtFrame()): one posted during a period
+  // then falls due in the next, at the same offset
+  uint32_t getFrameAfter(double sec) {
+    const jack_time_t now = jack_get_time();
+    const auto usec = static_cast<int64_t>(sec * 1e6);
+    const jack_time_t t =
+        usec < 0 && static_cast<jack_time_t>(-usec) > now ? 0 : now + usec;
+    return jack_time_to_frames(client, t) + jack_get_buffer_size(client);
+  }
+  // threads rendering voices, including the JACK thread
+  int getNumRenderThreads() const { return renderPool.getNumWorkers() + 1; }
+  // smoothed fraction of each period that a render thread spends on voices.
+  // thread 0 is the JACK thread
+  float getRenderLoad(int i) const { return renderPool.getLoad(i); }
+  // commands dropped because a lane was full, and times commands were left
+  // waiting for a later period (see Commands)
+  uint32_t getDroppedCommands() const {
+    return Commands::softcutCommands.getDropped();
+  }
+  uint32_t getDeferredCommands() const {
+    return Commands::softcutCommands.getDeferred();
+  }
+  // timed commands applied after their frame
+  uint32_t getLateCommands() const {
+    return Commands::softcutCommands.getLate();
+  }
+  // buffer memory: address space reserved vs. physically committed
+  size_t getBufferReservedBytes(int i) const { return buf[i].reservedBytes(); }
+  size_t getBufferCommittedBytes(int i) const {
+    return buf[i].committedBytes();
+  }
+  // commit buffer memory for voice `i`'s loop on the disk thread, so that
+  // recording there doesn't take page faults on the audio thread.
+  // called whenever a voice is armed to record
+  void prefaultLoop(int i) {
+    if (i < 0 || i >= NumVoices) {
+      return;
+    }
+    const float start = getLoopStart(i);
+    BufDiskWorker::requestPrefault(bufIdx[voiceBuf[i]], start,
+                                   getLoopEnd(i) - start);
+  }
   void SetPrimeSensitivity(int i, float sensitivity) {
     for (int j = 0; j < NumVoices; ++j) {
       primeSensitivity[j] = sensitivity;
@@ -135,14 +185,20 @@ class SoftcutClient : public JackClient<2, 2> {
  private:
   // processors
   softcut::Softcut<NumVoices> cut;
-  // main buffer
-  sample_t buf[2][BufFrames];
+  // main buffer; pages are committed as they are first written
+  LoopBuffer buf[2] = {LoopBuffer(BufFrames), LoopBuffer(BufFrames)};
   // buffer index for use with BufDiskWorker
   int bufIdx[2];
+  // buffer each voice plays from
+  int voiceBuf[NumVoices];
   // busses
   StereoBus mix;
   MonoBus input[NumVoices];
   MonoBus output[NumVoices];
+  // the last MaxBlockFrames frames of each voice's output, oldest first.
+  // feedback is mixed from here, so it is delayed by exactly one block on
+  // every frame, even after a short block
+  MonoBus feedback[NumVoices];
   // levels
   LogRamp inLevel[2][NumVoices];
   LogRamp outLevel[NumVoices];
@@ -150,7 +206,6 @@ class SoftcutClient : public JackClient<2, 2> {
   LogRamp fbLevel[NumVoices][NumVoices];
   // enabled flags
   bool enabled[NumVoices];
-  softcut::phase_t quantPhase[NumVoices];
   float sampleRate;
 
   VUMeter vuMeters[NumVoices];
@@ -158,16 +213,69 @@ class SoftcutClient : public JackClient<2, 2> {
   bool isPrimed[NumVoices];
   bool isPrimedToRecordOnce[NumVoices];
   bool wasPrimed[NumVoices];
-  bool doneRecordingPrimed[NumVoices];
   float primeSensitivity[NumVoices];
 
+  // renders groups of voices in parallel
+  RenderPool renderPool;
+  //-- per-period render state, read by the render threads
+  const sample_t *voiceIn[NumVoices];
+  sample_t *voiceOut[NumVoices];
+  // voices rendered on each thread
+  bool laneVoices[RenderPool::MaxLanes][NumVoices];
+  int renderFrames;
+  // voices rendered by the last render
+  bool rendered[NumVoices];
+  // voices rendered while playing for some of this block
+  bool played[NumVoices];
+
+  //-- events for other threads
+  EventRing oscEvents;
+  EventRing uiEvents;
+  // record flags at the end of the last period
+  bool recording[NumVoices];
+
  private:
   void process(jack_nframes_t numFrames) override;
+  // process frames [offset, offset + numFrames) of the period, which
+  // start at JACK frame `frameTime`. `splits` counts timed-command
+  // splits made so far this period, and `budget` is what is left of its
+  // command budget (see Commands::handlePending)
+  void processBlock(uint32_t frameTime, int offset, int numFrames,
+                    int &splits, int &budget);
+  // render voices over frames [offset, offset + numFrames) of the block
+  void renderVoices(int offset, int numFrames);
+  // split voices between render threads for the next render;
+  // returns the number of threads to use
+  int scheduleVoices(int numFrames);
+  static void renderLane(void *ctx, int lane);
+  // pass on the last render's voice events; it started at JACK frame
+  // `frameTime`
+  void postEvents(uint32_t frameTime);
+  void postEvent(const Event &e);
   void setSampleRate(jack_nframes_t) override;
+  void setBufferSize(jack_nframes_t) override;
   inline size_t secToFrame(float sec) {
     return static_cast<size_t>(sec * jack_get_sample_rate(JackClient::client));
   }
   float getLoopDuration();
+  // apply a command now, without the queue: from the audio thread,
+  // or before the client is activated
+  template <typename... Args>
+  void applyCommand(Commands::Id id, Args... args) {
+    Commands::CommandPacket p(id, args...);
+    handleCommand(&p);
+  }
+  void updateRate(int i) {
+    cut.setRate(i, rateSet[i] * rateBase[i] * (rateForward[i] ? 1.f : -1.f));
+  }
+  // start recording a primed voice, from the audio thread
+  void recordPrimed(int i);
+  void applyReset();
+  // point a voice at buffer `b`
+  void setVoiceBuffer(int voice, int b) {
+    voiceBuf[voice] = b;
+    cut.setVoiceBuffer(voice, buf[b].data(), BufFrames);
+  }
 
  public:
   /// FIXME: the "commands" structure shouldn't really be necessary.
@@ -254,47 +362,74 @@ class SoftcutClient : public JackClient<2, 2> {
     BufDiskWorker::requestClear(bufIdx[chan], start, dur);
   }
 
-  // check if quantized phase has changed for a given voice
-  // returns true
-  bool checkVoiceQuantPhase(int i) {
-    if (quantPhase[i] != cut.getQuantPhase(i)) {
-      quantPhase[i] = cut.getQuantPhase(i);
-      return true;
+  // keep mip levels of a buffer, for cleaner playback above unity rate.
+  // they are built on the disk thread, and voices pick them up from the
+  // next period
+  void setBufferMips(int chan, bool on) {
+    if (chan < 0 || chan > 1) {
+      return;
+    }
+    if (on) {
+      BufDiskWorker::requestBuildMips(bufIdx[chan]);
     } else {
-      return false;
+      buf[chan].disableMips();
     }
   }
+
+  // events from the audio thread, for one consumer thread each.
+  // the UI ring leaves out quantized phase changes
+  EventRing &getOscEvents() { return oscEvents; }
+  EventRing &getUiEvents() { return uiEvents; }
+
   softcut::phase_t getQuantPhase(int i) { return cut.getQuantPhase(i); }
-  void setPhaseQuant(int i, softcut::phase_t q) { cut.setPhaseQuant(i, q); }
-  void setPhaseOffset(int i, float sec) { cut.setPhaseOffset(i, sec); }
+  void setPhaseQuant(int i, softcut::phase_t q) {
+    Commands::softcutCommands.post(Commands::Id::SET_CUT_PHASE_QUANT, i,
+                                   static_cast<float>(q));
+  }
+  void setPhaseOffset(int i, float sec) {
+    Commands::softcutCommands.post(Commands::Id::SET_CUT_PHASE_OFFSET, i, sec);
+  }
 
   int getNumVoices() const { return NumVoices; }
 
   float getSampleRate() const { return sampleRate; }
 
-  void reset();
+  void reset() { Commands::softcutCommands.post(Commands::Id::RESET, 0.f); }
 
   // Reverb methods
-  void setReverbEnabled(bool enabled) { reverbEnabled = enabled; }
+  void setReverbEnabled(bool enabled) {
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_ENABLED,
+                                   enabled ? 1.f : 0.f);
+  }
 
-  void setReverbMix(float mix) { reverbMix.setTarget(mix); }
+  void setReverbMix(float mix) {
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_MIX, mix);
+  }
 
   void setReverbSend(int voice, float level) {
     if (voice >= 0 && voice < NumVoices) {
-      reverbSend[voice].setTarget(level);
+      Commands::softcutCommands.post(Commands::Id::SET_REVERB_SEND, voice,
+                                     level);
     }
   }
 
-  void setReverbDecay(float decay) { reverb.SetDecay(decay); }
+  void setReverbDecay(float decay) {
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_DECAY, decay);
+  }
 
-  void setReverbTailDensity(float density) { reverb.SetTailDensity(density); }
+  void setReverbTailDensity(float density) {
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_TAIL_DENSITY,
+                                   density);
+  }
 
   void setReverbInputDiffusion1(float diffusion) {
-    reverb.SetInputDiffision1(diffusion);
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_INPUT_DIFFUSION_1,
+                                   diffusion);
   }
 
   void setReverbInputDiffusion2(float diffusion) {
-    reverb.SetInputDiffision2(diffusion);
+    Commands::softcutCommands.post(Commands::Id::SET_REVERB_INPUT_DIFFUSION_2,
+                                   diffusion);
   }
 
   // Session recording methods
@@ -321,7 +456,9 @@ class SoftcutClient : public JackClient<2, 2> {
   StereoBus voiceOutputBus[NumVoices];  // Stereo output for each voice
   SessionRecorder sessionRecorder_;
   void clearBusses(size_t numFrames);
-  void mixInput(size_t numFrames);
+  void mixInput(size_t offset, size_t numFrames);
+  // append the block's output to the feedback history
+  void pushFeedback(size_t numFrames);
   void mixOutput(size_t numFrames);
 };
 }  // namespace softcut_jack_osc
@@ -71,8 +71,8 @@ int main() {
     g_sc = std::make_unique<SoftcutClient>();
     g_sc->setup();
     BufDiskWorker::init(static_cast<float>(g_sc->getSampleRate()));
-    g_sc->start();
     g_sc->init();
+    g_sc->start();
     g_sc->connectAdcPorts();
     g_sc->connectDacPorts();
 
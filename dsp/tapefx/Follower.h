@@ -18,6 +18,7 @@ class Follower {
   float process(float x);
 
  private:
+  friend class TapeFX;
   float a_, b_, y_;
 };
 
@@ -26,7 +26,8 @@ void TapeFX::SetBias(float bias) { bias_ = bias; }
 
 void TapeFX::SetPregain(float pregain) { pregain_ = pregain; }
 
-void TapeFX::ProcessMono(sample_t *out, unsigned int numFrames) {
+template <typename T>
+void TapeFX::ProcessMono(T *out, unsigned int numFrames) {
   for (size_t i = 0; i < numFrames; i++) {
     // pregain
     out[i] *= pregain_;
@@ -34,7 +35,7 @@ void TapeFX::ProcessMono(sample_t *out, unsigned int numFrames) {
     // dc bias with follower
     out[i] = tanhf(out[i] + (follow_ * bias_));
     // DC blocking
-    sample_t in = out[i];
+    T in = out[i];
     out[i] = in - dc_input_l_ + (dc_gain_ * dc_output_l_);
     dc_output_l_ = out[i];
     dc_input_l_ = in;
@@ -43,7 +44,8 @@ void TapeFX::ProcessMono(sample_t *out, unsigned int numFrames) {
   }
 }
 
-void TapeFX::Process(sample_t **out, unsigned int numFrames) {
+template <typename T>
+void TapeFX::Process(T **out, unsigned int numFrames) {
   for (size_t i = 0; i < numFrames; i++) {
     // pregain
     out[0][i] *= pregain_;
@@ -56,7 +58,7 @@ void TapeFX::Process(sample_t **out, unsigned int numFrames) {
     out[1][i] = tanhf(out[1][i] + (follow_ * bias_));
 
     // DC blocking
-    sample_t in = out[0][i];
+    T in = out[0][i];
     out[0][i] = in - dc_input_l_ + (dc_gain_ * dc_output_l_);
     dc_output_l_ = out[0][i];
     dc_input_l_ = in;
@@ -70,3 +72,8 @@ void TapeFX::Process(sample_t **out, unsigned int numFrames) {
     out[1][i] = tanhf(out[1][i]);
   }
 }
+
+template void TapeFX::ProcessMono<float>(float *, unsigned int);
+template void TapeFX::ProcessMono<double>(double *, unsigned int);
+template void TapeFX::Process<float>(float **, unsigned int);
+template void TapeFX::Process<double>(double **, unsigned int);
@@ -1,27 +1,105 @@
 #ifndef LIB_TAPEEMU_H
 #define LIB_TAPEEMU_H
 
-#include "Follower.h"
+#include <math.h>
 
-typedef double sample_t;
+#include "Follower.h"
 
 class TapeFX {
  public:
   TapeFX();
   void Init(float sample_rate);
-  void Process(sample_t **out, unsigned int numFrames);
-  void ProcessMono(sample_t *out, unsigned int numFrames);
+  // process in place; defined for float and double samples
+  template <typename T>
+  void Process(T **out, unsigned int numFrames);
+  template <typename T>
+  void ProcessMono(T *out, unsigned int numFrames);
+  // process N mono instances in lockstep, one lane per instance.
+  // `buf` is frame-major: buf[i * N + v] is frame i of instance v.
+  // only instances with `active[v]` set are read or written;
+  // the other lanes output zero.
+  template <int N, typename T>
+  static void ProcessMonoBank(TapeFX *const *fx, const bool *active, T *buf,
+                              unsigned int numFrames) {
+    float pregain[N] = {}, bias[N] = {}, fa[N] = {}, fb[N] = {}, fy[N] = {};
+    double follow[N] = {}, dcIn[N] = {}, dcOut[N] = {}, dcGain[N] = {};
+    for (int v = 0; v < N; ++v) {
+      if (!active[v]) {
+        continue;
+      }
+      pregain[v] = fx[v]->pregain_;
+      bias[v] = fx[v]->bias_;
+      fa[v] = fx[v]->follower.a_;
+      fb[v] = fx[v]->follower.b_;
+      fy[v] = fx[v]->follower.y_;
+      follow[v] = fx[v]->follow_;
+      dcIn[v] = fx[v]->dc_input_l_;
+      dcOut[v] = fx[v]->dc_output_l_;
+      dcGain[v] = fx[v]->dc_gain_;
+    }
+    // same operations as ProcessMono(), split into passes across lanes
+    for (unsigned int i = 0; i < numFrames; ++i) {
+      T *x = buf + i * N;
+      float arg[N];
+      for (int v = 0; v < N; ++v) {
+        // pregain
+        x[v] *= pregain[v];
+        // envelope follower
+        const float ax = std::abs(static_cast<float>(x[v]));
+        const float c = ax > fy[v] ? fa[v] : fb[v];
+        fy[v] = c * fy[v] + (1 - c) * ax;
+        follow[v] = fy[v];
+        arg[v] = static_cast<float>(x[v] + (follow[v] * bias[v]));
+      }
+      // dc bias with follower
+      for (int v = 0; v < N; ++v) {
+        x[v] = active[v] ? tanhf(arg[v]) : 0;
+      }
+      // DC blocking
+      for (int v = 0; v < N; ++v) {
+        const T in = x[v];
+        x[v] = in - dcIn[v] + (dcGain[v] * dcOut[v]);
+        dcOut[v] = x[v];
+        dcIn[v] = in;
+        arg[v] = static_cast<float>(x[v]);
+      }
+      // extra tanh
+      for (int v = 0; v < N; ++v) {
+        x[v] = active[v] ? tanhf(arg[v]) : 0;
+      }
+    }
+    for (int v = 0; v < N; ++v) {
+      if (active[v]) {
+        fx[v]->follower.y_ = fy[v];
+        fx[v]->follow_ = follow[v];
+        fx[v]->dc_input_l_ = dcIn[v];
+        fx[v]->dc_output_l_ = dcOut[v];
+      }
+    }
+  }
+
   void SetBias(float bias);
   void SetPregain(float pregain);
+  // true if processing silence as T would output silence and leave the state
+  // unchanged. the follower and the DC blocker may settle on a denormal
+  // rather than zero, so this checks for a fixed point instead of zero state.
+  template <typename T>
+  bool IsSilent() const {
+    return follower.b_ * follower.y_ == follower.y_ &&
+           follow_ == follower.y_ &&
+           static_cast<float>(follow_ * bias_) == 0.f && dc_input_l_ == 0 &&
+           static_cast<T>(dc_gain_ * dc_output_l_) == dc_output_l_ &&
+           static_cast<float>(dc_output_l_) == 0.f;
+  }
   float getFollowerValue() { return follow_; }
   float GetBias() { return bias_; }
   float GetPregain() { return pregain_; }
 
  private:
-  sample_t dc_input_l_, dc_output_l_, dc_gain_;
-  sample_t dc_input_r_, dc_output_r_;
+  double dc_input_l_, dc_output_l_, dc_gain_;
+  double dc_input_r_, dc_output_r_;
   float bias_, pregain_;
   Follower follower;
-  sample_t follow_;
+  double follow_;
 };
 #endif
@@ -24,29 +24,39 @@ class FadeCurves {
   // set curve shape
   void setPreShape(Shape x);
   void setRecShape(Shape x);
+  // set the shape of the playback crossfade
+  void setMixShape(Shape x);
   // x is assumed to be in [0,1]
   float getRecFadeValue(float x);
 
   float getPreFadeValue(float x);
 
+  // playback gain of a subhead at fade level x.
+  // exactly 0 and 1 at either end of the fade
+  float getMixGain(float x);
+
  private:
   void calcPreFade();
   void calcRecFade();
+  void calcMixGain();
 
  private:
   // xfade curve buffers
   static constexpr unsigned int fadeBufSize = 1001;
 
-  // record delay and pre window in fade, as proportion of fade time
-  float recDelayRatio;
-  float preWindowRatio;
+  // record delay and pre window in fade, as proportion of fade time.
+  // init() reads these before it sets them, so they need defaults
+  float recDelayRatio = 1.f / (8 * 16);
+  float preWindowRatio = 1.f / 8;
   // minimum record delay/pre window, in frames
-  unsigned int recDelayMinFrames;
-  unsigned int preWindowMinFrames;
+  unsigned int recDelayMinFrames = 0;
+  unsigned int preWindowMinFrames = 0;
   float recFadeBuf[fadeBufSize];
   float preFadeBuf[fadeBufSize];
-  Shape recShape;
-  Shape preShape;
+  float mixGainBuf[fadeBufSize];
+  Shape recShape = Raised;
+  Shape preShape = Linear;
+  Shape mixShape = Sine;
 };
 }  // namespace softcut
 
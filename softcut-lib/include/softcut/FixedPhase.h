@@ -0,0 +1,55 @@
+#ifndef Softcut_FIXEDPHASE_H
+#define Softcut_FIXEDPHASE_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "Types.h"
+
+namespace softcut {
+// a buffer position or per-frame increment in 32.32 fixed point: whole
+// frames in the high word, the fraction in the low word.
+// sums are exact, so a head lands on the same positions on every platform,
+// and the buffer index is the high word, wrapped with a mask.
+// converts to phase_t implicitly; from it only explicitly, rounding to the
+// nearest 2^-32 frame.
+struct FixedPhase {
+  int64_t raw;
+
+  FixedPhase() = default;
+  explicit FixedPhase(phase_t x) : raw(std::llrint(x * 4294967296.0)) {}
+
+  operator phase_t() const {
+    return static_cast<phase_t>(raw) * (1.0 / 4294967296.0);
+  }
+
+  // whole frames, rounded down
+  int index() const { return static_cast<int>(raw >> 32); }
+
+  // fraction of a frame, in [0, 1)
+  template <typename T>
+  T frac() const {
+    return static_cast<T>(static_cast<uint32_t>(raw)) *
+           static_cast<T>(1.0 / 4294967296.0);
+  }
+
+  friend FixedPhase operator+(FixedPhase a, FixedPhase b) {
+    return fromRaw(a.raw + b.raw);
+  }
+  friend FixedPhase operator-(FixedPhase a, FixedPhase b) {
+    return fromRaw(a.raw - b.raw);
+  }
+  friend bool operator<(FixedPhase a, FixedPhase b) { return a.raw < b.raw; }
+  friend bool operator>(FixedPhase a, FixedPhase b) { return a.raw > b.raw; }
+  friend bool operator<=(FixedPhase a, FixedPhase b) { return a.raw <= b.raw; }
+  friend bool operator>=(FixedPhase a, FixedPhase b) { return a.raw >= b.raw; }
+
+  static FixedPhase fromRaw(int64_t r) {
+    FixedPhase p;
+    p.raw = r;
+    return p;
+  }
+};
+}  // namespace softcut
+
+#endif  // Softcut_FIXEDPHASE_H
@@ -0,0 +1,62 @@
+#ifndef Softcut_FLOAT4_H
+#define Softcut_FLOAT4_H
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace softcut {
+// four floats operated on together: one SSE or NEON register where the
+// target has them, plain floats otherwise. each operation rounds exactly
+// as the same scalar float operation would
+struct Float4 {
+#if defined(__SSE2__)
+  __m128 v;
+
+  static Float4 set1(float x) { return {_mm_set1_ps(x)}; }
+  static Float4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+  void store(float *p) const { _mm_storeu_ps(p, v); }
+
+  friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+  friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+  friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t v;
+
+  static Float4 set1(float x) { return {vdupq_n_f32(x)}; }
+  static Float4 load(const float *p) { return {vld1q_f32(p)}; }
+  void store(float *p) const { vst1q_f32(p, v); }
+
+  friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+  friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+  friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+#else
+  float v[4];
+
+  static Float4 set1(float x) { return {{x, x, x, x}}; }
+  static Float4 load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+  void store(float *p) const {
+    for (int k = 0; k < 4; ++k) {
+      p[k] = v[k];
+    }
+  }
+
+  friend Float4 operator+(Float4 a, Float4 b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+             a.v[3] + b.v[3]}};
+  }
+  friend Float4 operator-(Float4 a, Float4 b) {
+    return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+             a.v[3] - b.v[3]}};
+  }
+  friend Float4 operator*(Float4 a, Float4 b) {
+    return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2],
+             a.v[3] * b.v[3]}};
+  }
+#endif
+};
+}  // namespace softcut
+
+#endif  // Softcut_FLOAT4_H
@@ -5,6 +5,14 @@
 #ifndef Softcut_INTERPOLATE_H
 #define Softcut_INTERPOLATE_H
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+
 namespace softcut {
 class Interpolate {
  public:
@@ -18,15 +26,135 @@ class Interpolate {
             T c3 = 0.5 * (y3 - y0) + 1.5 * (y1 - y2);
             return ((c3 * x + c2) * x + c1) * x + c0;
 #else  // inlined:
-    return (((0.5 * (y3 - y0) + 1.5 * (y1 - y2)) * x +
-             (y0 - 2.5 * y1 + 2. * y2 - 0.5 * y3)) *
+    // (constants in T, so float doesn't promote to double)
+    return (((T(0.5) * (y3 - y0) + T(1.5) * (y1 - y2)) * x +
+             (y0 - T(2.5) * y1 + T(2) * y2 - T(0.5) * y3)) *
                 x +
-            0.5 * (y2 - y0)) *
+            T(0.5) * (y2 - y0)) *
                x +
            y1;
 #endif
   }
 
+  // interpolation kernels, cheapest first
+  enum Quality {
+    Linear = 0,    // 2 points
+    Hermite = 1,   // 4-point, 3rd-order hermite; the default
+    SixPoint = 2,  // 6-point, 5th-order hermite
+    Sinc = 3,      // 16-point kaiser-windowed sinc, polyphase table
+  };
+  enum { NumQualities = 4, MaxPoints = 16 };
+
+  // Kernel<Q>::interp(x, y) interpolates `points` values y[0..points),
+  // at x in [0, 1] between y[points / 2 - 1] and y[points / 2]
+  template <Quality Q>
+  struct Kernel;
+
+  // number of points read by a kernel
+  static int points(Quality q) {
+    static const int p[NumQualities] = {2, 4, 6, MaxPoints};
+    return p[q];
+  }
+
+  // 4-point hermite at a block of phases, from a buffer without wrapping.
+  // assumes every phase is non-negative and every index in
+  // [phase - 1, phase + 2] is inside the buffer.
+  // vector kernels are used where the build target supports them.
+  static inline void hermiteBlock(const double *buf, const double *phase,
+                                  double *out, int n) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256d k05 = _mm256_set1_pd(0.5);
+    const __m256d k15 = _mm256_set1_pd(1.5);
+    const __m256d k25 = _mm256_set1_pd(2.5);
+    const __m256d k2 = _mm256_set1_pd(2.0);
+    for (; i + 4 <= n; i += 4) {
+      const __m256d p = _mm256_loadu_pd(phase + i);
+      const __m128i i1 = _mm256_cvttpd_epi32(p);
+      const __m256d x = _mm256_sub_pd(p, _mm256_cvtepi32_pd(i1));
+      const __m256d y0 = _mm256_i32gather_pd(buf - 1, i1, 8);
+      const __m256d y1 = _mm256_i32gather_pd(buf, i1, 8);
+      const __m256d y2 = _mm256_i32gather_pd(buf + 1, i1, 8);
+      const __m256d y3 = _mm256_i32gather_pd(buf + 2, i1, 8);
+      _mm256_storeu_pd(out + i, hermite4(x, y0, y1, y2, y3, k05, k15, k25, k2));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t k05 = vdupq_n_f64(0.5);
+    const float64x2_t k15 = vdupq_n_f64(1.5);
+    const float64x2_t k25 = vdupq_n_f64(2.5);
+    const float64x2_t k2 = vdupq_n_f64(2.0);
+    for (; i + 2 <= n; i += 2) {
+      const int a = static_cast<int>(phase[i]);
+      const int b = static_cast<int>(phase[i + 1]);
+      const float64x2_t p = vld1q_f64(phase + i);
+      const double xi[2] = {static_cast<double>(a), static_cast<double>(b)};
+      const float64x2_t x = vsubq_f64(p, vld1q_f64(xi));
+      // no gathers; load both frames' neighborhoods and transpose
+      const float64x2_t a01 = vld1q_f64(buf + a - 1);
+      const float64x2_t a23 = vld1q_f64(buf + a + 1);
+      const float64x2_t b01 = vld1q_f64(buf + b - 1);
+      const float64x2_t b23 = vld1q_f64(buf + b + 1);
+      const float64x2_t y0 = vzip1q_f64(a01, b01);
+      const float64x2_t y1 = vzip2q_f64(a01, b01);
+      const float64x2_t y2 = vzip1q_f64(a23, b23);
+      const float64x2_t y3 = vzip2q_f64(a23, b23);
+      vst1q_f64(out + i, hermite4(x, y0, y1, y2, y3, k05, k15, k25, k2));
+    }
+#endif
+    for (; i < n; ++i) {
+      const int i1 = static_cast<int>(phase[i]);
+      const auto x = phase[i] - static_cast<double>(i1);
+      out[i] = hermite<double>(x, buf[i1 - 1], buf[i1], buf[i1 + 1],
+                               buf[i1 + 2]);
+    }
+  }
+
+  static inline void hermiteBlock(const float *buf, const double *phase,
+                                  float *out, int n) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m128 k05 = _mm_set1_ps(0.5f);
+    const __m128 k15 = _mm_set1_ps(1.5f);
+    const __m128 k25 = _mm_set1_ps(2.5f);
+    const __m128 k2 = _mm_set1_ps(2.f);
+    for (; i + 4 <= n; i += 4) {
+      const __m256d p = _mm256_loadu_pd(phase + i);
+      const __m128i i1 = _mm256_cvttpd_epi32(p);
+      const __m128 x = _mm256_cvtpd_ps(_mm256_sub_pd(p, _mm256_cvtepi32_pd(i1)));
+      const __m128 y0 = _mm_i32gather_ps(buf - 1, i1, 4);
+      const __m128 y1 = _mm_i32gather_ps(buf, i1, 4);
+      const __m128 y2 = _mm_i32gather_ps(buf + 1, i1, 4);
+      const __m128 y3 = _mm_i32gather_ps(buf + 2, i1, 4);
+      _mm_storeu_ps(out + i, hermite4(x, y0, y1, y2, y3, k05, k15, k25, k2));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t k05 = vdupq_n_f32(0.5f);
+    const float32x4_t k15 = vdupq_n_f32(1.5f);
+    const float32x4_t k25 = vdupq_n_f32(2.5f);
+    const float32x4_t k2 = vdupq_n_f32(2.f);
+    for (; i + 4 <= n; i += 4) {
+      float xs[4];
+      float ys[4][4];
+      for (int j = 0; j < 4; ++j) {
+        const int i1 = static_cast<int>(phase[i + j]);
+        xs[j] = static_cast<float>(phase[i + j] - static_cast<double>(i1));
+        for (int k = 0; k < 4; ++k) {
+          ys[k][j] = buf[i1 - 1 + k];
+        }
+      }
+      vst1q_f32(out + i, hermite4(vld1q_f32(xs), vld1q_f32(ys[0]),
+                                  vld1q_f32(ys[1]), vld1q_f32(ys[2]),
+                                  vld1q_f32(ys[3]), k05, k15, k25, k2));
+    }
+#endif
+    for (; i < n; ++i) {
+      const int i1 = static_cast<int>(phase[i]);
+      const auto x = static_cast<float>(phase[i] - static_cast<double>(i1));
+      out[i] =
+          hermite<float>(x, buf[i1 - 1], buf[i1], buf[i1 + 1], buf[i1 + 2]);
+    }
+  }
+
   // super-simple interpolation into a table.
   // this makes assumptions for speed:
   // - allocated table size is >= N+1
@@ -41,6 +169,143 @@ class Interpolate {
     const float c = (fi - static_cast<float>(i));
     return a + c * (b - a);
   }
+
+ private:
+  // windowed sinc coefficients for `SincPhases` + 1 evenly spaced x in
+  // [0, 1], each phase normalized to unity gain
+  enum { SincPhases = 512 };
+  struct SincTable {
+    float c[SincPhases + 1][MaxPoints];
+    SincTable();
+  };
+  static const SincTable sincTable;
+
+ private:
+  // vector forms of `hermite()`, with the same order of operations
+#if defined(__AVX2__)
+  static inline __m256d hermite4(__m256d x, __m256d y0, __m256d y1,
+                                 __m256d y2, __m256d y3, __m256d k05,
+                                 __m256d k15, __m256d k25, __m256d k2) {
+    const __m256d c3 = _mm256_add_pd(_mm256_mul_pd(k05, _mm256_sub_pd(y3, y0)),
+                                     _mm256_mul_pd(k15, _mm256_sub_pd(y1, y2)));
+    const __m256d c2 = _mm256_sub_pd(
+        _mm256_add_pd(_mm256_sub_pd(y0, _mm256_mul_pd(k25, y1)),
+                      _mm256_mul_pd(k2, y2)),
+        _mm256_mul_pd(k05, y3));
+    const __m256d c1 = _mm256_mul_pd(k05, _mm256_sub_pd(y2, y0));
+    __m256d r = _mm256_add_pd(_mm256_mul_pd(c3, x), c2);
+    r = _mm256_add_pd(_mm256_mul_pd(r, x), c1);
+    return _mm256_add_pd(_mm256_mul_pd(r, x), y1);
+  }
+  static inline __m128 hermite4(__m128 x, __m128 y0, __m128 y1, __m128 y2,
+                                __m128 y3, __m128 k05, __m128 k15, __m128 k25,
+                                __m128 k2) {
+    const __m128 c3 = _mm_add_ps(_mm_mul_ps(k05, _mm_sub_ps(y3, y0)),
+                                 _mm_mul_ps(k15, _mm_sub_ps(y1, y2)));
+    const __m128 c2 =
+        _mm_sub_ps(_mm_add_ps(_mm_sub_ps(y0, _mm_mul_ps(k25, y1)),
+                              _mm_mul_ps(k2, y2)),
+                   _mm_mul_ps(k05, y3));
+    const __m128 c1 = _mm_mul_ps(k05, _mm_sub_ps(y2, y0));
+    __m128 r = _mm_add_ps(_mm_mul_ps(c3, x), c2);
+    r = _mm_add_ps(_mm_mul_ps(r, x), c1);
+    return _mm_add_ps(_mm_mul_ps(r, x), y1);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static inline float64x2_t hermite4(float64x2_t x, float64x2_t y0,
+                                     float64x2_t y1, float64x2_t y2,
+                                     float64x2_t y3, float64x2_t k05,
+                                     float64x2_t k15, float64x2_t k25,
+                                     float64x2_t k2) {
+    const float64x2_t c3 = vaddq_f64(vmulq_f64(k05, vsubq_f64(y3, y0)),
+                                     vmulq_f64(k15, vsubq_f64(y1, y2)));
+    const float64x2_t c2 =
+        vsubq_f64(vaddq_f64(vsubq_f64(y0, vmulq_f64(k25, y1)),
+                            vmulq_f64(k2, y2)),
+                  vmulq_f64(k05, y3));
+    const float64x2_t c1 = vmulq_f64(k05, vsubq_f64(y2, y0));
+    float64x2_t r = vaddq_f64(vmulq_f64(c3, x), c2);
+    r = vaddq_f64(vmulq_f64(r, x), c1);
+    return vaddq_f64(vmulq_f64(r, x), y1);
+  }
+  static inline float32x4_t hermite4(float32x4_t x, float32x4_t y0,
+                                     float32x4_t y1, float32x4_t y2,
+                                     float32x4_t y3, float32x4_t k05,
+                                     float32x4_t k15, float32x4_t k25,
+                                     float32x4_t k2) {
+    const float32x4_t c3 = vaddq_f32(vmulq_f32(k05, vsubq_f32(y3, y0)),
+                                     vmulq_f32(k15, vsubq_f32(y1, y2)));
+    const float32x4_t c2 =
+        vsubq_f32(vaddq_f32(vsubq_f32(y0, vmulq_f32(k25, y1)),
+                            vmulq_f32(k2, y2)),
+                  vmulq_f32(k05, y3));
+    const float32x4_t c1 = vmulq_f32(k05, vsubq_f32(y2, y0));
+    float32x4_t r = vaddq_f32(vmulq_f32(c3, x), c2);
+    r = vaddq_f32(vmulq_f32(r, x), c1);
+    return vaddq_f32(vmulq_f32(r, x), y1);
+  }
+#endif
+};
+template <>
+struct Interpolate::Kernel<Interpolate::Linear> {
+  enum { points = 2 };
+  template <typename T>
+  static inline T interp(T x, const T *y) {
+    return y[0] + (y[1] - y[0]) * x;
+  }
+};
+
+template <>
+struct Interpolate::Kernel<Interpolate::Hermite> {
+  enum { points = 4 };
+  template <typename T>
+  static inline T interp(T x, const T *y) {
+    return hermite<T>(x, y[0], y[1], y[2], y[3]);
+  }
+};
+
+template <>
+struct Interpolate::Kernel<Interpolate::SixPoint> {
+  enum { points = 6 };
+  // after Olli Niemitalo, "Polynomial Interpolators for High-Quality
+  // Resampling of Oversampled Audio"
+  template <typename T>
+  static inline T interp(T x, const T *y) {
+    const T eighthym2 = T(1. / 8) * y[0];
+    const T elevenTwentyFourthy2 = T(11. / 24) * y[4];
+    const T twelfthy3 = T(1. / 12) * y[5];
+    const T c0 = y[2];
+    const T c1 = T(1. / 12) * (y[0] - y[4]) + T(2. / 3) * (y[3] - y[1]);
+    const T c2 = T(13. / 12) * y[1] - T(25. / 12) * y[2] + T(1.5) * y[3] -
+                 elevenTwentyFourthy2 + twelfthy3 - eighthym2;
+    const T c3 = T(5. / 12) * y[2] - T(7. / 12) * y[3] + T(7. / 24) * y[4] -
+                 T(1. / 24) * (y[0] + y[1] + y[5]);
+    const T c4 = eighthym2 - T(7. / 12) * y[1] + T(13. / 12) * y[2] - y[3] +
+                 elevenTwentyFourthy2 - twelfthy3;
+    const T c5 = T(1. / 24) * (y[5] - y[0]) + T(5. / 24) * (y[1] - y[4]) +
+                 T(5. / 12) * (y[3] - y[2]);
+    return ((((c5 * x + c4) * x + c3) * x + c2) * x + c1) * x + c0;
+  }
+};
+
+template <>
+struct Interpolate::Kernel<Interpolate::Sinc> {
+  enum { points = MaxPoints };
+  // coefficients are interpolated linearly between table phases
+  template <typename T>
+  static inline T interp(T x, const T *y) {
+    const float fp = static_cast<float>(x) * SincPhases;
+    const int p = std::min(static_cast<int>(fp), SincPhases - 1);
+    const float f = fp - static_cast<float>(p);
+    const float *c0 = sincTable.c[p];
+    const float *c1 = sincTable.c[p + 1];
+    T a = 0, b = 0;
+    for (int k = 0; k < points; ++k) {
+      a += c0[k] * y[k];
+      b += c1[k] * y[k];
+    }
+    return a + (b - a) * f;
+  }
 };
 }  // namespace softcut
 
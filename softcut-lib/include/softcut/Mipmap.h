@@ -0,0 +1,51 @@
+#ifndef Softcut_MIPMAP_H
+#define Softcut_MIPMAP_H
+
+#include <cstddef>
+
+#include "Types.h"
+
+namespace softcut {
+// decimated copies of a buffer, for playing it back fast without aliasing.
+// level L has one frame for every 2^L frames of the buffer, lowpassed to its
+// own nyquist by a halfband filter applied L times over;
+// frame j of level L lines up with buffer frame j << L.
+// heads that write the buffer keep the levels up to date (see
+// ReadWriteHead::setMipmap()); other writers call update() afterwards.
+class Mipmap {
+ public:
+  enum {
+    NumLevels = 3,
+    // buffer frames either side of a phase that a level read depends on,
+    // and either side of an updated range that the update reads
+    Reach = 80,
+  };
+
+  // frames of level storage for a buffer of `frames`
+  static size_t storageFrames(unsigned int frames) {
+    return frames / 2 + frames / 4 + frames / 8;
+  }
+
+  // set the buffer, and storage for its levels of at least
+  // storageFrames(frames). nothing is computed until update().
+  // **NB** buffer size must be a power of two, at least 2^NumLevels
+  void setBuffer(const sample_t *buf, sample_t *levels, unsigned int frames);
+
+  // recompute the level frames that depend on buffer frames [lo, hi].
+  // indices wrap around the buffer. unchanged frames are not stored,
+  // so storage that is still zero over silence is never written.
+  void update(long lo, long hi);
+  void rebuild() { update(0, static_cast<long>(frames_) - 1); }
+
+  // level `L`, in [1, NumLevels], and its index mask
+  const sample_t *level(int L) const { return level_[L]; }
+  unsigned int mask(int L) const { return (frames_ >> L) - 1; }
+
+ private:
+  const sample_t *buf_ = nullptr;
+  sample_t *level_[NumLevels + 1] = {};
+  unsigned int frames_ = 0;
+};
+}  // namespace softcut
+
+#endif  // Softcut_MIPMAP_H
@@ -5,9 +5,14 @@
 #ifndef CUTFADEVOICE_CUTFADEVOICELOGIC_H
 #define CUTFADEVOICE_CUTFADEVOICELOGIC_H
 
+#include <array>
+#include <cmath>
 #include <cstdint>
 
 #include "FadeCurves.h"
+#include "Mipmap.h"
+#include "Resampler.h"
+#include "SoftClip.h"
 #include "SubHead.h"
 #include "TestBuffers.h"
 #include "Types.h"
@@ -18,13 +23,27 @@ class ReadWriteHead {
  public:
   void init(FadeCurves *fc);
 
-  // per-sample update functions
-  void processSample(sample_t in, sample_t *out);
-  void processSampleNoRead(sample_t in, sample_t *out);
-  void processSampleNoWrite(sample_t in, sample_t *out);
+  // process a block of frames with per-frame rate, pre and rec levels.
+  // this advances the head positions by `numFrames`;
+  // if `read` is set, the crossfaded output is written to `out`;
+  // if `write` is set, `in` is recorded to the buffer.
+  // a kernel specialized on read/write/rec-once/loop is selected per block.
+  void processBlock(const float *rate, const float *pre, const float *rec,
+                    const sample_t *in, sample_t *out, int numFrames,
+                    bool read, bool write);
+  // process a block in lockstep with `lead`, which must have just processed
+  // the same number of frames: positions, fades and levels are taken from
+  // its block rather than computed, and only peek/poke/mix runs here,
+  // on this head's own buffer.
+  void followBlock(const ReadWriteHead &lead, const sample_t *in,
+                   sample_t *out, int numFrames, bool read, bool write);
 
   void setSampleRate(float sr);
   void setBuffer(sample_t *buf, uint32_t size);
+  // mip levels of the buffer, or null. with levels, reads above unity rate
+  // come from them, and this head updates them after each block it writes
+  // in; they lag its writes by at most a block.
+  void setMipmap(Mipmap *mips);
   void setRate(rate_t x);
 
   // set loop (region) start point in seconds
@@ -57,10 +76,40 @@ class ReadWriteHead {
   float getLoopEnd() { return end / sr; }
 
   void setRecOffsetSamples(int d);
+  // interpolation kernel for reads and for the input resampler
+  void setInterpolation(Interpolate::Quality q);
 
   phase_t getActivePhase();
   rate_t getRate();
 
+  // a pass over a loop point
+  struct LoopWrap {
+    int frame;      // frame of the block at which it happened
+    phase_t phase;  // phase the head jumps to
+  };
+  // loop points passed in the block just processed, in order.
+  // at most `MaxLoopWraps` are kept
+  enum { MaxLoopWraps = 8 };
+  int getNumLoopWraps() const { return numWraps; }
+  const LoopWrap &getLoopWrap(int k) const { return wraps[k]; }
+  // frame of the block just processed at which rec-once finished,
+  // if getRecOnceDone() is set
+  int getRecOnceDoneFrame() const { return recOnceDoneFrame; }
+  // first frame of the block just processed from which the active subhead
+  // stays in [lo, hi); `numFrames` if only its final phase is in range
+  int getEntryFrame(phase_t lo, phase_t hi, int numFrames);
+
+  // playback gain for each frame of the block just processed, falling to
+  // zero where a read passes within `window` frames of a write made by
+  // `ref` in its own block. returns false, leaving `gain` as is, if no read
+  // came that close, which is checked once for the whole block.
+  bool duckGain(const ReadWriteHead &ref, phase_t window, float *gain,
+                int numFrames);
+
+  // bounds on the phase read or written over the next `numFrames`,
+  // with the rate magnitude at most `maxRate`
+  void getBlockSpan(rate_t maxRate, int numFrames, phase_t &lo, phase_t &hi);
+
  protected:
   friend class SubHead;
 
@@ -69,20 +118,129 @@ class ReadWriteHead {
   // assumption: phase is in range!
   void cutToPhase(phase_t newPhase);
   void enqueueCrossfade(phase_t newPhase);
-  void dequeueCrossfade();
+  // returns true if a queued crossfade was performed
+  bool dequeueCrossfade();
   void takeAction(Action act);
 
-  sample_t mixFade(sample_t x, sample_t y, float a,
-                   float b);  // mix two inputs with phases
+  //-- block kernels
+  typedef void (ReadWriteHead::*Kernel)(const float *, const float *,
+                                        const float *, const sample_t *,
+                                        sample_t *, int);
+  // indexed by read | write << 1 | recOnce << 2 | loop << 3
+  static const Kernel kernels[16];
+  typedef void (ReadWriteHead::*MixKernel)(const sample_t *, sample_t *, int);
+  // indexed by read | write << 1
+  static const MixKernel mixKernels[4];
+
+  template <bool Read, bool Write, bool RecOnce, bool Loop>
+  void processKernel(const float *rate, const float *pre, const float *rec,
+                     const sample_t *in, sample_t *out, int numFrames);
+  // compute per-frame state: rates, subhead phases and fades,
+  // and (if writing) record levels for each subhead
+  template <bool Write, bool RecOnce, bool Loop>
+  void updateBlock(const float *rate, const float *pre, const float *rec,
+                   int numFrames);
+  template <bool Write, bool RecOnce, bool Loop>
+  void updateFrame(const float *rate, const float *pre, const float *rec,
+                   int i);
+  // one head playing, the other stopped, nothing queued
+  bool isSteady() {
+    return !queuedCrossfadeFlag && head[active].state_ == Playing &&
+           head[active].active_ && head[active ^ 1].state_ == Stopped;
+  }
+  // fast path for steady state, from frame `i` up to the next loop point;
+  // returns the first frame not processed
+  template <bool Write, bool RecOnce>
+  int updateSteady(const float *rate, const float *pre, const float *rec,
+                   int i, int numFrames);
+  // peek/poke/mix, consuming state from `updateBlock()`
+  template <bool Read, bool Write>
+  void mixBlock(const sample_t *in, sample_t *out, int numFrames);
+  // true if writes in this block may land where this block reads;
+  // reads and writes must then be interleaved frame by frame
+  bool readHazard(int numFrames);
+  // read and crossfade both subheads for the whole block
+  void readBlock(sample_t *out, int numFrames);
+  // true if every write in the block has pre level 1 and rec level 0,
+  // and so leaves the buffer as it is
+  bool writesAreNoOp(int numFrames);
+  // advance write positions and the input resampler without writing
+  void skipWrites(const sample_t *in, int numFrames);
+  // true if the block reads from mip levels anywhere
+  bool readsMips(int numFrames);
+  // bring the mip levels up to date with the block's writes
+  void updateMips(int numFrames);
+
+  // feed the input resampler with frame `i` of the block, and write its
+  // clipped output with both subheads. the output goes through `clipBuf` a
+  // chunk at a time, so any rate fits
+  inline void writeFrame(int i, sample_t in) {
+    int nframes = 0;
+    if (head[0].pokeBuf_[i] != PokeNone || head[1].pokeBuf_[i] != PokeNone) {
+      setResampRate(rateBuf[i]);
+      nframes = resamp.processFrame(in);
+    }
+    while (nframes > 0) {
+      const int n = resamp.read(clipBuf.data(), Resampler::OUT_BUF_FRAMES);
+      for (int j = 0; j < n; ++j) {
+        clipBuf[j] = clip.processSample(clipBuf[j]);
+      }
+      head[0].poke(i, clipBuf.data(), n, rateBuf[i]);
+      head[1].poke(i, clipBuf.data(), n, rateBuf[i]);
+      nframes -= n;
+    }
+    head[0].endPoke(i);
+    head[1].endPoke(i);
+  }
+
+  inline void setResampRate(rate_t r) {
+    if (r != resampRate) {
+      // NB: resampler doesn't handle negative rates;
+      // subheads write its output backwards when rate < 0.
+      resampRate = r;
+      resamp.setRate(std::fabs(r));
+    }
+  }
+
+  // read and crossfade both subheads at frame `i`.
+  // outside of a crossfade only the playing subhead is read
+  inline sample_t mixFrame(int i) {
+    const float a = head[0].fadeBuf_[i];
+    const float b = head[1].fadeBuf_[i];
+    const rate_t r = rateBuf[i];
+    if (a == 1.f && b == 0.f) {
+      return head[0].peekRate(i, r);
+    }
+    if (a == 0.f && b == 1.f) {
+      return head[1].peekRate(i, r);
+    }
+    return head[0].peekRate(i, r) * fadeCurves->getMixGain(a) +
+           head[1].peekRate(i, r) * fadeCurves->getMixGain(b);
+  }
   void calcFadeInc();
 
  private:
   SubHead head[2];
+  FadeCurves *fadeCurves;
+
+  // input resampling is shared by both subheads;
+  // input history carries over position changes
+  Resampler resamp;
+  rate_t resampRate;  // rate last given to the resampler
+  phase_t resampStartPhase;  // resampler phase at the start of the block
+  SoftClip clip;
+  std::array<sample_t, Resampler::OUT_BUF_FRAMES> clipBuf;
+  // per-block read output for each subhead
+  std::array<sample_t, maxBlockFrames> readBuf[2];
+  // mip levels of the buffer, if any
+  Mipmap *mips = nullptr;
 
   sample_t *buf;  // audio buffer (allocated elsewhere)
   float sr;       // sample rate
   phase_t start;  // start/end points
   phase_t end;
+  subphase_t headStart;  // the same, as subhead phases
+  subphase_t headEnd;
   phase_t queuedCrossfade;
   bool queuedCrossfadeFlag;
   float fadeTime;  // fade time in seconds
@@ -97,6 +255,13 @@ class ReadWriteHead {
   int recOnceHead;   // keeps track of which subhead is writing
 
   rate_t rate;  // current rate
+  // loop points passed in this block
+  std::array<LoopWrap, MaxLoopWraps> wraps;
+  int numWraps;
+  bool wrapping;  // set while the active subhead is past a loop point
+  int recOnceDoneFrame;
+  // per-block rate, one entry per frame
+  std::array<rate_t, maxBlockFrames> rateBuf;
   TestBuffers testBuf;
 };
 }  // namespace softcut
@@ -5,6 +5,7 @@
 #ifndef SoftcutHEAD_RESAMPLER_H
 #define SoftcutHEAD_RESAMPLER_H
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
@@ -13,42 +14,78 @@
 #include "Types.h"
 
 // ultra-simple resampling class
-// works on mono output buffer and processes one input sample at a time
-
-// uncomment to use linear interpolation. honestly can't hear a huge difference?
-// FIXME: should be template param i guess
-// #define RESAMPLER_INTERPOLATE_LINEAR
+// works on mono output and processes one input sample at a time.
+// each input frame makes any number of output frames, however high the
+// rate; they are read out in chunks of whatever size the caller has room
+// for. interpolation quality is set at runtime; each kernel has its own
+// instantiation of the write loop
 
 namespace softcut {
 
 class Resampler {
  public:
   enum {
-    IN_BUF_FRAMES = 4,  // limits interpolation order
-    IN_BUF_MASK = 3,
-    OUT_BUF_FRAMES = 64  // limits resampling ratio
+    IN_BUF_FRAMES = Interpolate::MaxPoints,  // limits interpolation order
+    IN_BUF_MASK = IN_BUF_FRAMES - 1,
+    OUT_BUF_FRAMES = 64  // a convenient chunk size for read()
   };
 
   // constructor
   Resampler()
       : rate_(1.0),
         phi_(1.0),
-        phase_(0.0)
-#ifdef RESAMPLER_INTERPOLATE_LINEAR
-#else
-        ,
-        inBufIdx_(0)
-#endif
-  {
-  }
+        phase_(0.0),
+        inBuf_(),
+        inBufIdx_(0) {}
 
+  // push an input frame and advance the phase. returns the number of output
+  // frames it makes, to be taken with read() before the next input frame
   int processFrame(sample_t x) {
     pushInput(x);
-    if (rate_ > 1.0) {
-      return writeUp();
-    } else {
-      return writeDown();
+    phase_t p = phase_ + rate_;
+    auto nf = static_cast<unsigned int>(p);
+    // fractional output phase for interpolation, normalized to the distance
+    // between input frames: the distance to the first output frame boundary,
+    // divided by rate. upsampling steps on by 1/rate before each frame
+    outPhase_ = (1.0 - phase_) * phi_;
+    outStep_ = rate_ > 1.0 ? phi_ : 0.0;
+    // store the remainder of the updated, un-normalized output phase
+    phase_ = p - static_cast<phase_t>(nf);
+    pending_ = static_cast<int>(nf);
+    return pending_;
+  }
+
+  // write up to `maxFrames` of the output frames still to come from the last
+  // input frame to `dst`. returns the number written
+  int read(sample_t *dst, int maxFrames) {
+    const int n = std::min(pending_, maxFrames);
+    switch (quality_) {
+      case Interpolate::Linear:
+        write<Interpolate::Linear>(dst, n);
+        break;
+      case Interpolate::SixPoint:
+        write<Interpolate::SixPoint>(dst, n);
+        break;
+      case Interpolate::Sinc:
+        write<Interpolate::Sinc>(dst, n);
+        break;
+      default:
+        write<Interpolate::Hermite>(dst, n);
+        break;
     }
+    pending_ -= n;
+    return n;
+  }
+
+  // push an input frame and advance the phase as processFrame() does,
+  // without computing any output. returns the number of output frames
+  int skipFrame(sample_t x) {
+    pushInput(x);
+    phase_t p = phase_ + rate_;
+    auto nf = static_cast<unsigned int>(p);
+    phase_ = p - static_cast<phase_t>(nf);
+    pending_ = 0;
+    return nf;
   }
 
   void setRate(rate_t r) {
@@ -56,21 +93,18 @@ class Resampler {
     phi_ = 1.0 / r;
   }
   // void setBuffer(float *buf, int frames);
+  // kernels past 4-point hermite delay the output by another frame per
+  // pair of points, as they need more input after the interpolated point
+  void setQuality(Interpolate::Quality q) { quality_ = q; }
   void setPhase(phase_t phase) { phase_ = phase; }
-  const sample_t* output() { return static_cast<const sample_t*>(outBuf_); }
+  phase_t getPhase() const { return phase_; }
 
   void reset() {
-#ifdef RESAMPLER_INTERPOLATE_LINEAR
-    x_ = 0.f;
-#else
     for (sample_t &i : inBuf_) {
       i = 0.f;
     }
-    for (sample_t &i : outBuf_) {
-      i = 0.f;
-    }
     inBufIdx_ = 0;
-#endif
+    pending_ = 0;
   }
 
  private:
@@ -79,94 +113,41 @@ class Resampler {
   phase_t phi_;
   // last written phase
   phase_t phase_;
-#ifdef RESAMPLER_INTERPOLATE_LINEAR
-  // current input value
-  sample_t x_;
-  // last input value
-  sample_t x_1_;
-#else
+  Interpolate::Quality quality_ = Interpolate::Hermite;
   // input ringbuffer
   sample_t inBuf_[IN_BUF_FRAMES];
   unsigned int inBufIdx_;
-#endif
-  // output buffer
-  sample_t outBuf_[OUT_BUF_FRAMES];
+  // output frames still to read from the last input frame
+  int pending_ = 0;
+  // normalized phase of the last output frame, and the step to the next
+  phase_t outPhase_ = 0.0;
+  phase_t outStep_ = 0.0;
 
  private:
   // push an input value
   void pushInput(sample_t x) {
-#ifdef RESAMPLER_INTERPOLATE_LINEAR
-    x_1_ = x_;
-    x_ = x;
-#else
     inBufIdx_ = (inBufIdx_ + 1) & IN_BUF_MASK;
     inBuf_[inBufIdx_] = x;
-#endif
-  }
-
-  // interpolate the most recent input samples
-  // @param f in [0, 1]
-  sample_t interpolate(phase_t f) {
-#ifdef RESAMPLER_INTERPOLATE_LINEAR
-    return x_1_ + (x_ - x_1_) * f;
-#else
-    unsigned int i0, i1, i2, i3;
-    i0 = (inBufIdx_ + 1) & IN_BUF_MASK;
-    i1 = (inBufIdx_ + 2) & IN_BUF_MASK;
-    i2 = (inBufIdx_ + 3) & IN_BUF_MASK;
-    i3 = inBufIdx_;
-    return static_cast<sample_t>(Interpolate::hermite<phase_t>(
-        f, inBuf_[i0], inBuf_[i1], inBuf_[i2], inBuf_[i3]));
-#endif
   }
 
-  // write, upsampling
-  // return frames written (>= 1)
-  // assumptions: input has been pushed. rate_ > 1.0
-  int writeUp() {
-    phase_t p = phase_ + rate_;
-    auto nf = static_cast<unsigned int>(p);
-    // we can assume that n >= 1 here
-    // we want to track fractional output phase for interpolation
-    // this is normalized to the distance between input frames
-    // so: the distance to the first output frame boundary:
-    phase_t f = 1.0 - phase_;
-    // normalized (divided by rate);
-    f = f * phi_;
-    // write the first output frame
-    unsigned int i = 0;
-    outBuf_[i] = interpolate(f);
-    while (i < nf) {
-      // distance between output frames in this normalized space is 1/rate
-      f += phi_;
-      outBuf_[i] = interpolate(f);
-      i++;
+  // interpolate `n` output frames from the most recent input samples,
+  // between the second and third newest for kernels up to 4 points.
+  // the points are copied once, so long upsampled runs only evaluate the
+  // kernel
+  template <Interpolate::Quality Q>
+  void write(sample_t *dst, int n) {
+    constexpr int points = Interpolate::Kernel<Q>::points;
+    constexpr int first = points > 2 ? points - 1 : 2;
+    phase_t y[points];
+    for (int k = 0; k < points; ++k) {
+      y[k] = inBuf_[(inBufIdx_ - first + k) & IN_BUF_MASK];
     }
-    // store the remainder of the updated, un-normalized output phase
-    phase_ = p - static_cast<phase_t>(nf);
-    return nf;
-  }
-
-  // write, downsampling
-  // return frames written (0 or 1)
-  // assumptions: input has been pushed. rate_ <= 1.0
-  int writeDown() {
-    // number of frames will be 1 or 0.
-    // as with upsampling inner loop,
-    // we need to produce a fractional interpolation coefficient,
-    // by "normalizing" to the output phase period
-    phase_t p = phase_ + rate_;
-    // assert(p >= 0.0 /*resampler encountered negative phase*/);
-    auto nf = static_cast<unsigned int>(p);
-    if (nf > 0) {
-      phase_t f = 1.0 - phase_;
-      f *= phi_;
-      outBuf_[0] = interpolate(f);
-      phase_ = p - static_cast<phase_t>(nf);
-    } else {
-      phase_ = p;
+    phase_t f = outPhase_;
+    for (int i = 0; i < n; ++i) {
+      f += outStep_;
+      dst[i] = static_cast<sample_t>(Interpolate::Kernel<Q>::interp(f, y));
     }
-    return nf;
+    outPhase_ = f;
   }
 };
 
@@ -5,6 +5,9 @@
 #ifndef Softcut_Softcut_H
 #define Softcut_Softcut_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <memory>
 #include <thread>
 
@@ -24,10 +27,112 @@ class Softcut {
   }
 
   // assumption: channel count is equal to voice count!
+  // a follower (see setFollow()) takes the state of its leader's last
+  // processed frames, so here it must come right after its leader, with
+  // blocks of at most `maxBlockFrames`; processBlocks() has no such limit.
+  // the same goes for a ducked voice and its reference (see setDuck().)
   void processBlock(int v, const sample_t *in, sample_t *out, int numFrames) {
     scv[v].processBlockMono(in, out, numFrames);
   }
 
+  // process all voices over the same block, in lockstep.
+  // the filter, ramp and tape stages run across voices together,
+  // one lane per voice; heads still run one voice at a time.
+  // output is the same as calling processBlock() for each active voice.
+  // voices with `active[v]` unset are not touched, nor is `out[v]`,
+  // so calls with disjoint `active` sets may run on different threads
+  // as long as the voices do not interact (see groupVoices().)
+  // a follower, or a voice ducked by another (see setDuck()), must be
+  // active whenever the voice it depends on is; a follower whose leader is
+  // inactive runs on its own, and a voice whose reference is inactive is
+  // not ducked.
+  void processBlocks(const sample_t *const *in, sample_t *const *out,
+                     const bool *active, int numFrames) {
+    linkActive(active);
+    for (int v = 0; v < numVoices; ++v) {
+      if (active[v]) {
+        scv[v].clearEvents();
+      }
+    }
+    int offset = 0;
+    while (offset < numFrames) {
+      const int n = std::min(numFrames - offset, maxBlockFrames);
+      processLanes(in, out, active, offset, n);
+      offset += n;
+    }
+  }
+
+  // split active voices into groups that can be processed independently
+  // over the next `numFrames`. voices share a group if they use the same
+  // buffer, at least one of them records, and the frames they may touch
+  // overlap. followers and ducked voices share the group of the voice
+  // they depend on, if it is active.
+  // `group[v]` is set to the group index, or -1 for inactive voices.
+  // returns the number of groups.
+  int groupVoices(const bool *active, int numFrames, int *group) {
+    phase_t lo[numVoices], hi[numVoices];
+    bool touch[numVoices];
+    int root[numVoices];
+    linkActive(active);
+    for (int v = 0; v < numVoices; ++v) {
+      touch[v] = active[v] && scv[v].getBlockSpan(numFrames, lo[v], hi[v]);
+      root[v] = v;
+    }
+    auto join = [&](int a, int b) {
+      while (root[a] != a) {
+        a = root[a];
+      }
+      while (root[b] != b) {
+        b = root[b];
+      }
+      root[std::max(a, b)] = std::min(a, b);
+    };
+    for (int a = 0; a < numVoices; ++a) {
+      for (int b = a + 1; b < numVoices; ++b) {
+        if (!touch[a] || !touch[b] || scv[a].buf != scv[b].buf) {
+          continue;
+        }
+        if (!scv[a].headWrites() && !scv[b].headWrites()) {
+          continue;
+        }
+        if (!spansOverlap(lo[a], hi[a], lo[b], hi[b], scv[a].bufFrames)) {
+          continue;
+        }
+        join(a, b);
+      }
+    }
+    for (int v = 0; v < numVoices; ++v) {
+      if (active[v] && scv[v].activeLeader != nullptr) {
+        join(v, static_cast<int>(scv[v].activeLeader - scv));
+      }
+      if (active[v] && scv[v].activeDuckRef != nullptr) {
+        join(v, static_cast<int>(scv[v].activeDuckRef - scv));
+      }
+    }
+    int numGroups = 0;
+    for (int v = 0; v < numVoices; ++v) {
+      if (!active[v]) {
+        group[v] = -1;
+      } else if (root[v] == v) {
+        group[v] = numGroups++;
+      } else {
+        // roots always have a lower index, so are numbered already
+        int r = root[v];
+        while (root[r] != r) {
+          r = root[r];
+        }
+        group[v] = group[r];
+      }
+    }
+    return numGroups;
+  }
+
+  // span of buffer phase that voice `v` may write over the next
+  // `numFrames`, as groupVoices() finds it. returns false if it won't write
+  bool getWriteSpan(int v, int numFrames, phase_t &lo, phase_t &hi) {
+    return scv[v].headWrites() && scv[v].getBlockSpan(numFrames, lo, hi);
+  }
+
   void setSampleRate(unsigned int hz) {
     for (auto &v : scv) {
       v.setSampleRate(hz);
@@ -44,6 +149,12 @@ class Softcut {
 
   void setFadeTime(int voice, float sec) { scv[voice].setFadeTime(sec); }
 
+  void setFadeShape(int voice, int shape) { scv[voice].setFadeShape(shape); }
+
+  void setInterpolation(int voice, int quality) {
+    scv[voice].setInterpolation(quality);
+  }
+
   void setRecLevel(int voice, float amp) { scv[voice].setRecLevel(amp); }
 
   void setPreLevel(int voice, float amp) { scv[voice].setPreLevel(amp); }
@@ -98,6 +209,11 @@ class Softcut {
 
   phase_t getQuantPhase(int i) { return scv[i].getQuantPhase(); }
 
+  // events from the last call that processed voice `i`; see VoiceEvent.
+  // frames are offsets from the start of that call
+  int getNumEvents(int i) const { return scv[i].getNumEvents(); }
+  const VoiceEvent &getEvent(int i, int k) const { return scv[i].getEvent(k); }
+
   void setPhaseQuant(int i, phase_t q) { scv[i].setPhaseQuant(q); }
 
   void setPhaseOffset(int i, float sec) { scv[i].setPhaseOffset(sec); }
@@ -110,10 +226,47 @@ class Softcut {
     scv[follow].cutToPos(scv[lead].getActivePosition() + offset);
   }
 
+  // attenuate voice `voice` where it plays near the record position of
+  // voice `ref` on the same buffer, or stop if `ref` is negative
+  void setDuck(int voice, int ref) {
+    scv[voice].duck(ref < 0 ? nullptr : &scv[ref]);
+  }
+
+  void setDuckTime(int voice, float sec) { scv[voice].setDuckTime(sec); }
+
+  // keep voice `follow` hard-synced to voice `lead`, or stop if `lead` is
+  // negative (see Voice::follow().) there is one level of following:
+  // following a follower follows its leader, and the followers of a voice
+  // that starts following move to its new leader.
+  void setFollow(int follow, int lead) {
+    Voice *f = &scv[follow];
+    if (lead < 0 || lead == follow) {
+      f->follow(nullptr);
+      return;
+    }
+    Voice *l = &scv[lead];
+    if (l->leader == f) {
+      // swap roles
+      l->follow(nullptr);
+    } else if (l->leader != nullptr) {
+      l = l->leader;
+    }
+    f->follow(l);
+    for (int v = 0; v < numVoices; ++v) {
+      if (scv[v].leader == f) {
+        scv[v].follow(l);
+      }
+    }
+  }
+
   void setVoiceBuffer(int id, sample_t *buf, size_t bufFrames) {
     scv[id].setBuffer(buf, bufFrames);
   }
 
+  // mip levels of voice `id`'s buffer, or null to read it directly at
+  // every rate. the levels may be shared by every voice on the buffer
+  void setVoiceMipmap(int id, Mipmap *mips) { scv[id].setMipmap(mips); }
+
   void setTapeBias(int id, float bias) { scv[id].tapeFx.SetBias(bias); }
 
   void setTapePregain(int id, float pregain) {
@@ -134,6 +287,181 @@ class Softcut {
   void stopVoice(int i) { scv[i].stop(); }
 
  private:
+  // unlink active voices from inactive leaders and duck references,
+  // and relink the others
+  void linkActive(const bool *active) {
+    for (int v = 0; v < numVoices; ++v) {
+      if (active[v]) {
+        const Voice *l = scv[v].leader;
+        const Voice *d = scv[v].duckRef;
+        scv[v].linkActive(l != nullptr && active[l - scv],
+                          d != nullptr && active[d - scv]);
+      }
+    }
+  }
+
+  // process at most `maxBlockFrames` frames of every voice, starting at
+  // `offset`. lane buffers are frame-major: x[i * numVoices + v].
+  void processLanes(const sample_t *const *in, sample_t *const *out,
+                    const bool *active, int offset, int numFrames) {
+    constexpr int N = numVoices;
+    Svf *svfPre[N], *svfPost[N];
+    TapeFX *tapeFx[N];
+    float preDry[N] = {}, postDry[N] = {};
+    // lanes each stage has work for; stages at rest are skipped.
+    // input filters following a ramping rate run on their own
+    bool track[N], pre[N], tape[N], post[N];
+    bool anyPre = false;
+    bool anyPost = false;
+    for (int v = 0; v < N; ++v) {
+      if (!active[v]) {
+        continue;
+      }
+      scv[v].eventOffset = offset;
+      svfPre[v] = &scv[v].svfPre;
+      svfPost[v] = &scv[v].svfPost;
+      tapeFx[v] = &scv[v].tapeFx;
+      preDry[v] = scv[v].svfPreDryLevel;
+      postDry[v] = scv[v].svfPostDryLevel;
+    }
+    // lane buffers are local, so disjoint voice sets can run concurrently
+    alignas(64) sample_t x[maxBlockFrames * N];
+    alignas(64) float y[maxBlockFrames * N];
+
+    // parameter ramps; followers' heads don't use them
+    bool lead[N];
+    for (int v = 0; v < N; ++v) {
+      lead[v] = active[v] && scv[v].activeLeader == nullptr;
+      if (lead[v]) {
+        scv[v].rateMoving = !scv[v].rateRamp.isSettled();
+      }
+    }
+    updateRamps(&Voice::rateRamp, &Voice::rateBuf, lead, y, numFrames);
+    updateRamps(&Voice::preRamp, &Voice::preBuf, lead, y, numFrames);
+    updateRamps(&Voice::recRamp, &Voice::recBuf, lead, y, numFrames);
+
+    // input filter
+    for (int v = 0; v < N; ++v) {
+      track[v] = active[v] && scv[v].preFilterTracking();
+    }
+    for (int v = 0; v < N; ++v) {
+      if (track[v]) {
+        scv[v].processPreFilterTracking(in[v] + offset, numFrames);
+      }
+      pre[v] = active[v] && !track[v] &&
+               !scv[v].preFilterIdle(in[v] + offset, numFrames);
+      anyPre |= pre[v];
+    }
+    if (anyPre) {
+      for (int v = 0; v < N; ++v) {
+        for (int i = 0; i < numFrames; ++i) {
+          x[i * N + v] = pre[v] ? in[v][offset + i] : 0;
+        }
+      }
+      Svf::processBank<N>(svfPre, pre, x, x, preDry, numFrames);
+    }
+    for (int v = 0; v < N; ++v) {
+      if (pre[v]) {
+        for (int i = 0; i < numFrames; ++i) {
+          scv[v].inBuf[i] = x[i * N + v];
+        }
+      }
+    }
+
+    // heads, leaders first
+    for (int v = 0; v < N; ++v) {
+      if (lead[v]) {
+        scv[v].processHead(out[v] + offset, numFrames);
+      }
+    }
+    for (int v = 0; v < N; ++v) {
+      if (active[v] && !lead[v]) {
+        scv[v].processHead(out[v] + offset, numFrames);
+      }
+    }
+    for (int v = 0; v < N; ++v) {
+      tape[v] = false;
+      post[v] = false;
+      if (active[v]) {
+        sample_t *const dst = out[v] + offset;
+        scv[v].applyDuck(dst, numFrames);
+        tape[v] = !scv[v].tapeIdle(dst, numFrames);
+        post[v] = tape[v] || !scv[v].svfPost.processSilence(dst, postDry[v],
+                                                            numFrames);
+        anyPost |= post[v];
+      }
+    }
+    if (!anyPost) {
+      return;
+    }
+
+    // tape fx, then post filter
+    for (int v = 0; v < N; ++v) {
+      for (int i = 0; i < numFrames; ++i) {
+        x[i * N + v] = post[v] ? out[v][offset + i] : 0;
+      }
+    }
+    TapeFX::ProcessMonoBank<N>(tapeFx, tape, x,
+                               static_cast<unsigned int>(numFrames));
+    Svf::processBank<N>(svfPost, post, x, x, postDry, numFrames);
+    for (int v = 0; v < N; ++v) {
+      if (post[v]) {
+        for (int i = 0; i < numFrames; ++i) {
+          out[v][offset + i] = x[i * N + v];
+        }
+      }
+    }
+  }
+
+  // fill one ramp buffer for each active voice;
+  // ramps that have settled just repeat their value
+  void updateRamps(LogRamp Voice::*src,
+                   std::array<float, maxBlockFrames> Voice::*dst,
+                   const bool *active, float *y, int numFrames) {
+    constexpr int N = numVoices;
+    LogRamp *ramp[N];
+    bool moving[N];
+    bool anyMoving = false;
+    for (int v = 0; v < N; ++v) {
+      ramp[v] = &(scv[v].*src);
+      moving[v] = active[v] && !(skipIdle && ramp[v]->isSettled());
+      anyMoving |= moving[v];
+    }
+    if (anyMoving) {
+      LogRamp::updateBank<N>(ramp, moving, y, numFrames);
+    }
+    for (int v = 0; v < N; ++v) {
+      if (moving[v]) {
+        for (int i = 0; i < numFrames; ++i) {
+          (scv[v].*dst)[i] = y[i * N + v];
+        }
+      } else if (active[v]) {
+        std::fill_n((scv[v].*dst).data(), numFrames, ramp[v]->getValue());
+      }
+    }
+  }
+
+  // true if two spans of phase overlap, once wrapped to the buffer
+  static bool spansOverlap(phase_t aLo, phase_t aHi, phase_t bLo, phase_t bHi,
+                           int frames) {
+    const phase_t n = frames;
+    if (aHi - aLo >= n || bHi - bLo >= n) {
+      return true;
+    }
+    const phase_t a = aLo - n * std::floor(aLo / n);
+    const phase_t b = bLo - n * std::floor(bLo / n);
+    const phase_t aLen = aHi - aLo;
+    const phase_t bLen = bHi - bLo;
+    // compare against b and its copy one buffer length either side
+    for (int k = -1; k <= 1; ++k) {
+      const phase_t c = b + k * n;
+      if (a <= c + bLen && c <= a + aLen) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   Voice scv[numVoices];
 };
 }  // namespace softcut
@@ -9,15 +9,33 @@
 #ifndef Softcut_SUBHEAD_H
 #define Softcut_SUBHEAD_H
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
 #include "FadeCurves.h"
-#include "Resampler.h"
-#include "SoftClip.h"
+#include "FixedPhase.h"
+#include "Interpolate.h"
+#include "Mipmap.h"
 #include "Types.h"
+#include "Utilities.h"
 
 namespace softcut {
 
+// subhead position and increment.
+// define SOFTCUT_FIXED_PHASE to accumulate them in 32.32 fixed point
+#ifdef SOFTCUT_FIXED_PHASE
+typedef FixedPhase subphase_t;
+#else
+typedef phase_t subphase_t;
+#endif
+
 typedef enum { Playing = 0, Stopped = 1, FadeIn = 2, FadeOut = 3 } State;
 typedef enum { None, Stop, LoopPos, LoopNeg } Action;
+// what a subhead does with its input on a given frame.
+// the input resampler is fed while either subhead is not `PokeNone`
+typedef enum { PokeNone = 0, PokeFeed = 1, PokeWrite = 2 } Poke;
 
 class SubHead {
   friend class ReadWriteHead;
@@ -27,19 +45,202 @@ class SubHead {
   void setSampleRate(float sr);
 
  private:
-  sample_t peek4();
-  unsigned int wrapBufIndex(int x);
+  template <Interpolate::Quality Q>
+  inline sample_t peekAt(subphase_t phase) {
+    constexpr int points = Interpolate::Kernel<Q>::points;
+#ifdef SOFTCUT_FIXED_PHASE
+    const int phase1 = phase.index();
+    const auto x = phase.frac<sample_t>();
+#else
+    // rounded down: a head fading out past the start of the buffer reads
+    // at negative phases, and kernels need x in [0, 1)
+    int phase1 = static_cast<int>(phase);
+    phase1 -= phase < static_cast<phase_t>(phase1);
+    const auto x = static_cast<sample_t>(phase - static_cast<phase_t>(phase1));
+#endif
+    sample_t y[points];
+    for (int k = 0; k < points; ++k) {
+      y[k] = buf_[wrapBufIndex(phase1 - (points / 2 - 1) + k)];
+    }
+    return Interpolate::Kernel<Q>::interp(x, y);
+  }
+
+  template <Interpolate::Quality Q>
+  void peekBlockWith(sample_t *out, int numFrames);
+
+  // read mip level `L` at a buffer phase, with hermite interpolation
+  inline sample_t peekLevel(int L, subphase_t phase) {
+#ifdef SOFTCUT_FIXED_PHASE
+    const auto p = FixedPhase::fromRaw(phase.raw >> L);
+    const int phase1 = p.index();
+    const auto x = p.frac<sample_t>();
+#else
+    static constexpr phase_t scale[] = {1.0, 0.5, 0.25, 0.125, 0.0625};
+    const phase_t p = phase * scale[L];
+    int phase1 = static_cast<int>(p);
+    phase1 -= p < static_cast<phase_t>(phase1);
+    const auto x = static_cast<sample_t>(p - static_cast<phase_t>(phase1));
+#endif
+    const sample_t *y = mips_->level(L);
+    const unsigned int m = mips_->mask(L);
+    return Interpolate::hermite<sample_t>(
+        x, y[static_cast<unsigned int>(phase1 - 1) & m],
+        y[static_cast<unsigned int>(phase1) & m],
+        y[static_cast<unsigned int>(phase1 + 1) & m],
+        y[static_cast<unsigned int>(phase1 + 2) & m]);
+  }
+
+  // mip level to read at a rate magnitude, and how far to crossfade
+  // towards the next one: log2 of the rate, limited to the levels there are
+  static inline void mipLevel(rate_t rate, int &L, sample_t &f) {
+    if (rate <= 1) {
+      L = 0;
+      f = 0;
+      return;
+    }
+    const rate_t lod =
+        std::min(std::log2(rate), static_cast<rate_t>(Mipmap::NumLevels));
+    L = static_cast<int>(lod);
+    f = L < Mipmap::NumLevels ? static_cast<sample_t>(lod - L) : 0;
+  }
+
+  // read frame `i` of the current block at mip level `L`, crossfaded by `f`
+  // towards level `L` + 1. level 0 is the buffer itself
+  inline sample_t peekMipAt(int i, int L, sample_t f) {
+    sample_t y = L == 0 ? peek(i) : peekLevel(L, phaseBuf_[i]);
+    if (f > 0) {
+      y += (peekLevel(L + 1, phaseBuf_[i]) - y) * f;
+    }
+    return y;
+  }
+
+  // the buffer size is a power of two, so masking wraps negative indices too
+  inline unsigned int wrapBufIndex(int x) {
+    const unsigned int i = static_cast<unsigned int>(x) & bufMask_;
+    assert(buf_ != nullptr && i < bufFrames_);
+    return i;
+  }
 
  protected:
-  static constexpr int blockSize = 2048;
-  sample_t peek();
-  //! poke
-  //! @param in: input value
-  //! @param pre: scaling level for previous buffer content
-  //! @param rec: scaling level for new content
-  void poke(sample_t in, float pre, float rec);
-  Action updatePhase(phase_t start, phase_t end, bool loop);
-  void updateFade(float inc);
+  // read the buffer at the phase computed for frame `i` of the current block
+  inline sample_t peek(int i) {
+    switch (quality_) {
+      case Interpolate::Linear:
+        return peekAt<Interpolate::Linear>(phaseBuf_[i]);
+      case Interpolate::SixPoint:
+        return peekAt<Interpolate::SixPoint>(phaseBuf_[i]);
+      case Interpolate::Sinc:
+        return peekAt<Interpolate::Sinc>(phaseBuf_[i]);
+      default:
+        return peekAt<Interpolate::Hermite>(phaseBuf_[i]);
+    }
+  }
+  // read frames [0, numFrames) of the current block at once
+  void peekBlock(sample_t *out, int numFrames);
+
+  // read frame `i` as peek() does, or from the mip levels, if there are
+  // any, when the rate magnitude is above 1
+  inline sample_t peekRate(int i, rate_t rate) {
+    if (mips_ == nullptr || std::fabs(rate) <= 1) {
+      return peek(i);
+    }
+    int L;
+    sample_t f;
+    mipLevel(std::fabs(rate), L, f);
+    return peekMipAt(i, L, f);
+  }
+  // read frames [0, numFrames) with peekRate(), at per-frame `rate`.
+  // mip levels must be set
+  void peekMipBlock(sample_t *out, const rate_t *rate, int numFrames);
+
+  //! poke, using the levels computed for frame `i` of the current block.
+  //! a frame's resampled input may come in several spans, one call each;
+  //! endPoke() then finishes the frame
+  //! @param src: resampled and clipped input, shared by both subheads
+  //! @param nframes: number of resampled frames in this span
+  //! @param rate: playback rate for this frame
+  inline void poke(int i, const sample_t *src, int nframes, rate_t rate) {
+    if (pokeBuf_[i] == PokeWrite) {
+      // NB: resampler doesn't handle negative rates.
+      // instead we copy the resampler output backwards into the buffer when
+      // rate < 0.
+      const int dir = static_cast<int>(fsign(rate));
+      const float preFade = preBuf_[i];
+      const float recFade = recBuf_[i];
+      for (int j = 0; j < nframes; ++j) {
+        buf_[wrIdx_] *= preFade;
+        buf_[wrIdx_] += src[j] * recFade;
+        wrIdx_ = wrapBufIndex(wrIdx_ + dir);
+      }
+    }
+  }
+
+  // finish frame `i` after its poke() calls
+  inline void endPoke(int i) {
+    // a position change during this frame moves the write index for the next
+    if (wrIdxBuf_[i] >= 0) {
+      wrIdx_ = static_cast<unsigned int>(wrIdxBuf_[i]);
+    }
+  }
+
+  // move the write index as poke() does, without writing
+  inline void skipPoke(int i, int nframes, rate_t rate) {
+    if (pokeBuf_[i] == PokeWrite) {
+      const int dir = static_cast<int>(fsign(rate));
+      wrIdx_ = wrapBufIndex(static_cast<int>(wrIdx_) + dir * nframes);
+    }
+    if (wrIdxBuf_[i] >= 0) {
+      wrIdx_ = static_cast<unsigned int>(wrIdxBuf_[i]);
+    }
+  }
+
+  // advance phase by one frame; `Loop` is fixed for the caller's block
+  template <bool Loop>
+  inline Action updatePhase(subphase_t start, subphase_t end) {
+    Action res = None;
+    trig_ = 0.f;
+    if (state_ != Stopped) {
+      const subphase_t p = phase_ + rate_;
+      if (active_ && (p > end || p < start)) {
+        if (Loop) {
+          trig_ = 1.f;
+          res = rate_ > 0.f ? LoopPos : LoopNeg;
+        } else {
+          state_ = FadeOut;
+          res = Stop;
+        }
+      }
+      phase_ = p;
+    }
+    return res;
+  }
+
+  inline void updateFade(float inc) {
+    if (state_ == FadeIn) {
+      fade_ += inc;
+      if (fade_ > 1.f) {
+        fade_ = 1.f;
+        state_ = Playing;
+      }
+    } else if (state_ == FadeOut) {
+      fade_ -= inc;
+      if (fade_ < 0.f) {
+        fade_ = 0.f;
+        state_ = Stopped;
+      }
+    }
+  }
+
+  // take the per-block state of `lead`'s current block, to read and write
+  // this subhead's buffer at the same positions and levels
+  void copyBlock(const SubHead &lead, int numFrames);
+  // take the position and fade of `lead` at the end of its block
+  void copyState(const SubHead &lead);
+
+  // save write position at the start of a block
+  void beginBlock() { wrIdxStart_ = wrIdx_; }
+  // restore it before consuming the block's write state
+  void beginPoke() { wrIdx_ = wrIdxStart_; }
 
   // getters
   phase_t phase() { return phase_; }
@@ -54,31 +255,50 @@ class SubHead {
   // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
   // **NB** buffer size must be a power of two!!!!
   void setBuffer(sample_t *buf, unsigned int frames);
+  // mip levels of the buffer for fast reads, or null
+  void setMipmap(const Mipmap *mips) { mips_ = mips; }
   void setRate(rate_t rate);
   FadeCurves *fadeCurves;
 
  private:
-  Resampler resamp_;
-  SoftClip clip_;
-
-  sample_t *buf_;       // output buffer
-  unsigned int wrIdx_;  // write index
-  unsigned int bufFrames_;
-  unsigned int bufMask_;
+  sample_t *buf_ = nullptr;  // output buffer
+  unsigned int wrIdx_;       // write index
+  unsigned int wrIdxStart_;
+  unsigned int bufFrames_ = 0;
+  unsigned int bufMask_ = 0;
 
   State state_;
-  rate_t rate_;
+  subphase_t rate_;  // phase increment per frame
   int inc_dir_;
-  phase_t phase_;
+  subphase_t phase_;
   float fade_;
   float trig_;  // output trigger value
   bool active_;
   int recOffset_;
+  // mip levels of the buffer, if any
+  const Mipmap *mips_ = nullptr;
 
-  float preFade_;
-  float recFade_;
+  //-- per-block state, one entry per frame
+  // read phase
+  std::array<subphase_t, maxBlockFrames> phaseBuf_;
+  // fade level
+  std::array<float, maxBlockFrames> fadeBuf_;
+  // pre level, with fade applied
+  std::array<float, maxBlockFrames> preBuf_;
+  // rec level, with fade applied
+  std::array<float, maxBlockFrames> recBuf_;
+  // input handling
+  std::array<Poke, maxBlockFrames> pokeBuf_;
+  // write index after a position change on this frame, or -1
+  std::array<int, maxBlockFrames> wrIdxBuf_;
 
   void setRecOffsetSamples(int d);
+  void setQuality(Interpolate::Quality q) { quality_ = q; }
+  // buffer frames read before and after a phase's whole frame
+  int readsBefore() const { return Interpolate::points(quality_) / 2 - 1; }
+  int readsAfter() const { return Interpolate::points(quality_) / 2; }
+
+  Interpolate::Quality quality_ = Interpolate::Hermite;
 };
 
 }  // namespace softcut
@@ -7,14 +7,26 @@
 #ifndef Softcut_SVF_H
 #define Softcut_SVF_H
 
+#include <algorithm>
 #include <memory>
 
+#include "Float4.h"
+#include "Types.h"
+
 class Svf {
  public:
+  // which filter outputs the mix uses, set from the mix levels.
+  // a bypassed filter contributes nothing, so block processing leaves its
+  // state as it was, to resume from there when the mix is turned back up
+  enum Mode { Bypass, LowPass, HighPass, Mix };
+
   Svf();
   float getNextSample(float x);
   void setSampleRate(float sr);
   void setFc(float fc);
+  // as setFc(), but the warp is interpolated from a table rather than
+  // computed with tan(); cheap enough to call at audio rate
+  void setFcFast(float fc);
   void setRq(float rq);
   void setLpMix(float mix);
   void setHpMix(float mix);
@@ -27,9 +39,258 @@ class Svf {
   void clearState();
 
   float getFc();
+  Mode getMode() const { return mode; }
+
+  // process a block: each output is what getNextSample() gives, plus the
+  // input scaled by `dry`. `in` and `out` may be the same buffer
+  template <typename T>
+  void process(const T *in, T *out, float dry, int numFrames) {
+    Svf *const self = this;
+    const bool active = true;
+    processBank<1>(&self, &active, in, out, &dry, numFrames);
+  }
+
+  // frames between coefficient updates in processMod()
+  enum { ModFrames = 16 };
+
+  // process a block like process(), with the cutoff following `fc`, one
+  // value in hz per frame. the cutoff is read at the end of every
+  // `ModFrames` frames and set with setFcFast(); the coefficients ramp
+  // linearly to it from where they were, so jumps don't zipper.
+  // the filter is left at the last cutoff
+  template <typename T>
+  void processMod(const T *in, T *out, const float *fc, float dry,
+                  int numFrames) {
+    for (int i0 = 0; i0 < numFrames; i0 += ModFrames) {
+      const int n = std::min(numFrames - i0, static_cast<int>(ModFrames));
+      const float a1 = g1, a2 = g2, a3 = g3, a4 = g4;
+      setFcFast(fc[i0 + n - 1]);
+      if (mode == Bypass) {
+        for (int i = i0; i < i0 + n; ++i) {
+          out[i] = in[i] * dry;
+        }
+        continue;
+      }
+      const float r = 1.f / n;
+      const float d1 = (g1 - a1) * r, d2 = (g2 - a2) * r;
+      const float d3 = (g3 - a3) * r, d4 = (g4 - a4) * r;
+      float c1 = a1, c2 = a2, c3 = a3, c4 = a4;
+      float s0 = v0z, s1 = v1, s2 = v2;
+      for (int i = i0; i < i0 + n - 1; ++i) {
+        c1 += d1;
+        c2 += d2;
+        c3 += d3;
+        c4 += d4;
+        out[i] = modSample(in[i], dry, c1, c2, c3, c4, s0, s1, s2);
+      }
+      // last frame lands exactly on the new coefficients
+      const int i = i0 + n - 1;
+      out[i] = modSample(in[i], dry, g1, g2, g3, g4, s0, s1, s2);
+      v0z = s0;
+      v1 = s1;
+      v2 = s2;
+    }
+  }
+
+  // on silent input, a decayed filter either stays put or (through rounding
+  // in the denormal range) alternates between two states. if it is in such
+  // a cycle, run `numFrames` of silence at once, writing what
+  // getNextSample() plus `dry` times the input would give, and return true.
+  // otherwise leave the filter untouched and return false.
+  template <typename T>
+  bool processSilence(T *out, float dry, int numFrames) {
+    if (!softcut::skipIdle) {
+      return false;
+    }
+    const T zero = 0;
+    if (mode == Bypass) {
+      std::fill_n(out, numFrames, zero * dry);
+      return true;
+    }
+    if (v0z != 0.f) {
+      return false;
+    }
+    float s1[2], s2[2], y[2];
+    float a1 = v1, a2 = v2;
+    for (int k = 0; k < 2; ++k) {
+      // same operations as update() and getNextSample(), with zero input
+      const float v3z = 0.f + 0.f - 2.f * a2;
+      const float b1 = a1 + (g1 * v3z - g2 * a1);
+      const float b2 = a2 + (g3 * v3z + g4 * a1);
+      const float hpz = 0.f - rq * b1 - b2;
+      const float brz = 0.f - rq * b1;
+      y[k] = b2 * lpMix + hpz * hpMix + b1 * bpMix + brz * brMix;
+      s1[k] = b1;
+      s2[k] = b2;
+      a1 = b1;
+      a2 = b2;
+    }
+    if (s1[0] == v1 && s2[0] == v2) {
+      y[1] = y[0];
+    } else if (!(s1[1] == v1 && s2[1] == v2)) {
+      return false;
+    }
+    const T out0 = y[0] + zero * dry;
+    const T out1 = y[1] + zero * dry;
+    for (int i = 0; i < numFrames; i += 2) {
+      out[i] = out0;
+    }
+    for (int i = 1; i < numFrames; i += 2) {
+      out[i] = out1;
+    }
+    if (numFrames & 1) {
+      v1 = s1[0];
+      v2 = s2[0];
+    }
+    return true;
+  }
+
+  // process N filters in lockstep, one lane per filter.
+  // `in` and `out` are frame-major: x[i * N + v] is frame i of filter v,
+  // and may be the same buffer. each output adds its input scaled by `dry`.
+  // only filters with `active[v]` set are read or written;
+  // the other lanes run from zero state.
+  // the kernel computes only the outputs that the active filters' modes
+  // need; bypassed filters just pass on their dry input.
+  template <int N, typename T>
+  static void processBank(Svf *const *f, const bool *active, const T *in,
+                          T *out, const float *dry, int numFrames) {
+    // the narrowest mode that covers every lane
+    Mode m = Bypass;
+    for (int v = 0; v < N; ++v) {
+      if (active[v] && f[v]->mode != Bypass && f[v]->mode != m) {
+        m = m == Bypass ? f[v]->mode : Mix;
+      }
+    }
+    switch (m) {
+      case Bypass:
+        for (int i = 0; i < numFrames; ++i) {
+          for (int v = 0; v < N; ++v) {
+            out[i * N + v] = in[i * N + v] * dry[v];
+          }
+        }
+        break;
+      case LowPass:
+        processBankMode<N, LowPass>(f, active, in, out, dry, numFrames);
+        break;
+      case HighPass:
+        processBankMode<N, HighPass>(f, active, in, out, dry, numFrames);
+        break;
+      case Mix:
+        processBankMode<N, Mix>(f, active, in, out, dry, numFrames);
+        break;
+    }
+  }
 
  private:
+  template <int N, Mode M, typename T>
+  static void processBankMode(Svf *const *f, const bool *active, const T *in,
+                              T *out, const float *dry, int numFrames) {
+    using softcut::Float4;
+    // lanes padded to whole vectors; padding lanes are inactive
+    constexpr int P = (N + 3) / 4 * 4;
+    float g1[P] = {}, g2[P] = {}, g3[P] = {}, g4[P] = {}, rq[P] = {};
+    float lpMix[P] = {}, hpMix[P] = {}, bpMix[P] = {}, brMix[P] = {};
+    float v0z[P] = {}, v1[P] = {}, v2[P] = {};
+    for (int v = 0; v < N; ++v) {
+      if (!active[v]) {
+        continue;
+      }
+      g1[v] = f[v]->g1;
+      g2[v] = f[v]->g2;
+      g3[v] = f[v]->g3;
+      g4[v] = f[v]->g4;
+      rq[v] = f[v]->rq;
+      lpMix[v] = f[v]->lpMix;
+      hpMix[v] = f[v]->hpMix;
+      bpMix[v] = f[v]->bpMix;
+      brMix[v] = f[v]->brMix;
+      v0z[v] = f[v]->v0z;
+      v1[v] = f[v]->v1;
+      v2[v] = f[v]->v2;
+    }
+    const Float4 two = Float4::set1(2.f);
+    // input as float, then wet output in its place
+    float buf[softcut::maxBlockFrames * P];
+    for (int i0 = 0; i0 < numFrames; i0 += softcut::maxBlockFrames) {
+      const int n = std::min(numFrames - i0, softcut::maxBlockFrames);
+      const T *x = in + i0 * N;
+      T *y = out + i0 * N;
+      for (int i = 0; i < n; ++i) {
+        for (int v = 0; v < P; ++v) {
+          buf[i * P + v] = v < N ? static_cast<float>(x[i * N + v]) : 0.f;
+        }
+      }
+      // same operations as update() and getNextSample(), on every vector of
+      // lanes in turn, so their recurrences overlap
+      for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < P; c += 4) {
+          float *b = buf + i * P + c;
+          const Float4 v0 = Float4::load(b);
+          const Float4 s0 = Float4::load(v0z + c);
+          const Float4 v1z = Float4::load(v1 + c);
+          const Float4 v2z = Float4::load(v2 + c);
+          const Float4 v3 = v0 + s0 - two * v2z;
+          const Float4 s1 = v1z + (Float4::load(g1 + c) * v3 -
+                                   Float4::load(g2 + c) * v1z);
+          const Float4 s2 = v2z + (Float4::load(g3 + c) * v3 +
+                                   Float4::load(g4 + c) * v1z);
+          v0.store(v0z + c);
+          s1.store(v1 + c);
+          s2.store(v2 + c);
+          Float4 mix;
+          if (M == LowPass) {
+            mix = s2 * Float4::load(lpMix + c);
+          } else if (M == HighPass) {
+            mix = (v0 - Float4::load(rq + c) * s1 - s2) *
+                  Float4::load(hpMix + c);
+          } else {
+            const Float4 r1 = Float4::load(rq + c) * s1;
+            const Float4 hp = v0 - r1 - s2;
+            const Float4 br = v0 - r1;
+            mix = s2 * Float4::load(lpMix + c) + hp * Float4::load(hpMix + c) +
+                  s1 * Float4::load(bpMix + c) + br * Float4::load(brMix + c);
+          }
+          mix.store(b);
+        }
+      }
+      for (int i = 0; i < n; ++i) {
+        for (int v = 0; v < N; ++v) {
+          y[i * N + v] = buf[i * P + v] + x[i * N + v] * dry[v];
+        }
+      }
+    }
+    // bypassed lanes ran on zero mix levels; their state is kept
+    for (int v = 0; v < N; ++v) {
+      if (active[v] && f[v]->mode != Bypass) {
+        f[v]->v0z = v0z[v];
+        f[v]->v1 = v1[v];
+        f[v]->v2 = v2[v];
+      }
+    }
+  }
+
+  // one frame of update() and getNextSample() with the given coefficients
+  // and state, plus the dry input
+  template <typename T>
+  T modSample(T x, float dry, float c1, float c2, float c3, float c4,
+              float &s0, float &s1, float &s2) const {
+    const float v0 = static_cast<float>(x);
+    const float v1z = s1;
+    const float v2z = s2;
+    const float v3 = v0 + s0 - 2.f * v2z;
+    s1 += c1 * v3 - c2 * v1z;
+    s2 += c3 * v3 + c4 * v1z;
+    s0 = v0;
+    const float hpOut = v0 - rq * s1 - s2;
+    const float brOut = v0 - rq * s1;
+    return s2 * lpMix + hpOut * hpMix + s1 * bpMix + brOut * brMix + x * dry;
+  }
+
+  void updateMode();
+
   static const float MAX_NORM_FC;
+  Mode mode = Mix;
   float lpMix;
   float hpMix;
   float bpMix;
@@ -37,6 +298,8 @@ class Svf {
   float minFc;
   float maxFc;
   float pi_sr;
+  // warp table entries per hz
+  float warpScale;
 
   // sample rate
   float sr;
@@ -6,8 +6,29 @@
 #define Softcut_TYPES_H
 
 namespace softcut {
+// audio storage and processing type.
+// define SOFTCUT_SINGLE_PRECISION to store buffers as 32-bit float;
+// phase and rate stay double either way.
+#ifdef SOFTCUT_SINGLE_PRECISION
+typedef float sample_t;
+#else
 typedef double sample_t;
+#endif
 typedef double phase_t;
 typedef double rate_t;
+
+// stages with nothing to do for a block (settled ramps, decayed filters,
+// silent tape fx, writes that leave the buffer as it is) are skipped.
+// building with SOFTCUT_NO_IDLE_SKIP runs them anyway, which only costs
+// time: the tests check that the output is the same either way
+#ifdef SOFTCUT_NO_IDLE_SKIP
+static constexpr bool skipIdle = false;
+#else
+static constexpr bool skipIdle = true;
+#endif
+
+// voices process audio in segments of at most this many frames;
+// per-block state buffers are sized accordingly
+static constexpr int maxBlockFrames = 128;
 }  // namespace softcut
 #endif  // Softcut_TYPES_H
@@ -159,6 +159,9 @@ class LogRamp {
   // get value
   float getValue() const { return y0; }
 
+  // true if the output has reached the target, so update() returns it as is
+  bool isSettled() const { return y0 == x0; }
+
   ~LogRamp() = default;
 
   void setSampleRate(float sr) {
@@ -178,10 +181,39 @@ class LogRamp {
 
   // update output only
   float update() {
-    y0 = smooth1pole(x0, y0, b);
+    y0 = settle(x0, y0, smooth1pole(x0, y0, b));
     return y0;
   }
 
+  // update N ramps in lockstep, one lane per ramp.
+  // `out` is frame-major: out[i * N + v] is frame i of ramp v.
+  // only ramps with `active[v]` set are read or written;
+  // the other lanes output zero.
+  template <int N>
+  static void updateBank(LogRamp *const *r, const bool *active, float *out,
+                         int numFrames) {
+    float x0[N] = {}, y0[N] = {}, b[N] = {};
+    for (int v = 0; v < N; ++v) {
+      if (!active[v]) {
+        continue;
+      }
+      x0[v] = r[v]->x0;
+      y0[v] = r[v]->y0;
+      b[v] = r[v]->b;
+    }
+    for (int i = 0; i < numFrames; ++i) {
+      for (int v = 0; v < N; ++v) {
+        y0[v] = settle(x0[v], y0[v], smooth1pole(x0[v], y0[v], b[v]));
+        out[i * N + v] = y0[v];
+      }
+    }
+    for (int v = 0; v < N; ++v) {
+      if (active[v]) {
+        r[v]->y0 = y0[v];
+      }
+    }
+  }
+
   // update input and output
   float process(float x) {
     setTarget(x);
@@ -194,6 +226,11 @@ class LogRamp {
     x0 = x;
     y0 = x;
   }
+
+ private:
+  // rounding can leave the smoother stuck one step short of its target
+  // (e.g. just below 1, or on a denormal above 0); land on it instead
+  static float settle(float x, float y0, float y) { return y == y0 ? x : y; }
 };
 
 // a smoother with separate rise and fall times
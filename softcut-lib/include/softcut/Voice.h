@@ -16,6 +16,21 @@
 #include "Utilities.h"
 
 namespace softcut {
+// something that happened to a voice's head while it was processed
+struct VoiceEvent {
+  enum Type {
+    LoopWrap,     // passed a loop point
+    QuantPhase,   // quantized phase changed
+    RecOnceDone,  // finished recording once
+  };
+  Type type;
+  // frame offset from the start of the processing call
+  int frame;
+  // in seconds: the position jumped to for LoopWrap,
+  // the new quantized phase for QuantPhase
+  phase_t value;
+};
+
 class Voice {
  public:
   Voice();
@@ -24,6 +39,10 @@ class Voice {
 
   void setBuffer(sample_t *buf, unsigned int numFrames);
 
+  // mip levels of the buffer, for playback above unity rate, or null;
+  // see ReadWriteHead::setMipmap()
+  void setMipmap(Mipmap *mips);
+
   void setSampleRate(float hz);
 
   void setRate(float rate);
@@ -36,6 +55,12 @@ class Voice {
 
   void setFadeTime(float sec);
 
+  // shape of the playback crossfade; see FadeCurves::Shape
+  void setFadeShape(int shape);
+
+  // interpolation for reading and recording; see Interpolate::Quality
+  void setInterpolation(int quality);
+
   void setRecLevel(float amp);
 
   void setPreLevel(float amp);
@@ -110,16 +135,89 @@ class Voice {
 
   void reset();
 
+  // span of buffer phase that the next `numFrames` may read or write,
+  // allowing for any loop point or queued position change.
+  // returns false if the voice will not touch its buffer at all
+  bool getBlockSpan(int numFrames, phase_t &lo, phase_t &hi);
+
   // immediately put both subheads in a stopped state
   void stop();
 
+  // hard-sync this voice's head to `lead`, or stop following if null.
+  // a follower reads and writes its own buffer at the leader's positions,
+  // fades and levels, and plays and records when the leader does; its own
+  // rate, levels, flags and loop settings are ignored until it stops.
+  // the leader's head must run first in each block. in a
+  // Softcut::processBlocks() call that leaves the leader out, the follower
+  // runs on its own settings.
+  void follow(Voice *lead);
+  Voice *getLeader() { return leader; }
+
+  // attenuate playback where it passes near `ref`'s record position on a
+  // shared buffer, or stop if null. the reference's head must run first in
+  // each block. in a Softcut::processBlocks() call that leaves the
+  // reference out, this voice is not ducked.
+  void duck(Voice *ref);
+  // distance from the record position, in seconds, over which playback
+  // fades out
+  void setDuckTime(float sec);
+
+  // events from the last processBlockMono() call, or the last
+  // Softcut::processBlocks() call that processed this voice, in order.
+  // past `MaxEvents`, further events are dropped
+  enum { MaxEvents = 64 };
+  int getNumEvents() const { return numEvents; }
+  const VoiceEvent &getEvent(int k) const { return events[k]; }
+
   // tape fx
   TapeFX tapeFx;
 
  private:
+  template <int>
+  friend class Softcut;
+
+  // process at most `maxBlockFrames` frames through each stage in turn
+  void processFrames(const sample_t *in, sample_t *out, int numFrames);
+  // run the head stage on `inBuf` and the ramp buffers, writing to `out`
+  void processHead(sample_t *out, int numFrames);
+  // if `in` is silent and the input filter has decayed, run the filter over
+  // it at once and return true
+  bool preFilterIdle(const sample_t *in, int numFrames);
+  // true if tape fx would pass the head output through as silence
+  bool tapeIdle(const sample_t *out, int numFrames);
+  // apply duck mode to the head output
+  void applyDuck(sample_t *out, int numFrames);
+
+  // true if the rate ramped over this block, so the input filter's cutoff
+  // should follow it. a follower's follows its leader's rate.
+  // check after updating the ramps
+  bool preFilterTracking() const {
+    return (activeLeader != nullptr ? activeLeader : this)->rateMoving;
+  }
+  // run the input filter with its cutoff following `rateBuf`, or the
+  // leader's
+  void processPreFilterTracking(const sample_t *in, int numFrames);
+  // input filter cutoff for a playback rate
+  float preFilterFc(float rate) const;
+
   void updatePreSvfFc();
 
-  void updateQuantPhase();
+  // true if the head writes to the buffer; a follower writes with its leader
+  bool headWrites() const {
+    return activeLeader != nullptr ? activeLeader->recFlag : recFlag;
+  }
+  // follow the leader, and duck under the reference, only if they are
+  // processed along with this voice
+  void linkActive(bool leaderActive, bool duckRefActive) {
+    activeLeader = leaderActive ? leader : nullptr;
+    activeDuckRef = duckRefActive ? duckRef : nullptr;
+  }
+
+  void updateQuantPhase(int numFrames);
+  // record events from the head's last block
+  void updateEvents(int numFrames);
+  void addEvent(VoiceEvent::Type type, int frame, phase_t value);
+  void clearEvents() { numEvents = 0; }
 
  private:
   sample_t *buf;
@@ -141,6 +239,20 @@ class Voice {
   // record-level ramp
   LogRamp recRamp;
 
+  //-- per-block state, filled stage by stage in processFrames()
+  // filtered input
+  std::array<sample_t, maxBlockFrames> inBuf;
+  // ramped parameter values
+  std::array<float, maxBlockFrames> rateBuf;
+  std::array<float, maxBlockFrames> preBuf;
+  std::array<float, maxBlockFrames> recBuf;
+  // duck gain
+  std::array<float, maxBlockFrames> duckBuf;
+  // input filter cutoff, while it follows a ramping rate
+  std::array<float, maxBlockFrames> preFcBuf;
+  // whether the rate ramp was moving at the start of this block
+  bool rateMoving = false;
+
   // default frequency for SVF
   // reduced automatically when setting rate
   float svfPreFcBase;
@@ -149,7 +261,7 @@ class Voice {
   float svfPreDryLevel = 1.0;
   float svfPostDryLevel = 1.0;
   // phase quantization unit, should be in [0,1]
-  phase_t phaseQuant;
+  phase_t phaseQuant = 1;
   // phase offset in sec
   float phaseOffset = 0;
 
@@ -158,9 +270,26 @@ class Voice {
   std::atomic<phase_t> rawPhase;
   std::atomic<phase_t> quantPhase;
 
+  std::array<VoiceEvent, MaxEvents> events;
+  int numEvents = 0;
+  // offset of the current block in the processing call, for event frames
+  int eventOffset = 0;
+
  private:
   bool playFlag;
   bool recFlag;
+  // voice this one follows, or null
+  Voice *leader = nullptr;
+  // the leader, while it is processed with this voice (see linkActive())
+  Voice *activeLeader = nullptr;
+  // voice whose record position ducks this one, or null
+  Voice *duckRef = nullptr;
+  // the reference, while it is processed with this voice
+  Voice *activeDuckRef = nullptr;
+  float duckTime = 0.01f;
+  // whether the head read and wrote in the last block
+  bool headRead = false;
+  bool headWrite = false;
 };
 }  // namespace softcut
 
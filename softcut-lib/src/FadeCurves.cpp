@@ -10,6 +10,7 @@
 #include <cstring>
 
 #include "softcut/Interpolate.h"
+#include "softcut/Utilities.h"
 
 using namespace softcut;
 
@@ -18,6 +19,7 @@ static constexpr float fpi = 3.1415926535898f;
 void FadeCurves::init() {
   setPreShape(FadeCurves::Shape::Linear);
   setRecShape(FadeCurves::Shape::Raised);
+  setMixShape(FadeCurves::Shape::Sine);
   setMinPreWindowFrames(0);
   setMinRecDelayFrames(0);
   setPreWindowRatio(1.f / 8);
@@ -120,6 +122,25 @@ void FadeCurves::calcPreFade() {
   memcpy(preFadeBuf, buf, fadeBufSize * sizeof(float));
 }
 
+void FadeCurves::calcMixGain() {
+  // Sine is equal power, Linear and Raised are equal gain
+  const unsigned int n = fadeBufSize - 1;
+  for (unsigned int i = 0; i <= n; ++i) {
+    const double x = static_cast<double>(i) / n;
+    double y;
+    if (mixShape == Sine) {
+      y = sin(x * M_PI_2);
+    } else if (mixShape == Raised) {
+      y = 0.5 - 0.5 * cos(x * M_PI);
+    } else {
+      y = x;
+    }
+    mixGainBuf[i] = static_cast<float>(y);
+  }
+  mixGainBuf[0] = 0.f;
+  mixGainBuf[n] = 1.f;
+}
+
 void FadeCurves::setRecDelayRatio(float x) {
   recDelayRatio = x;
   calcRecFade();
@@ -148,6 +169,10 @@ float FadeCurves::getPreFadeValue(float x) {
   return Interpolate::tabLinear<float, fadeBufSize>(preFadeBuf, x);
 }
 
+float FadeCurves::getMixGain(float x) {
+  return LUT<float>::lookupLinear(x, mixGainBuf, fadeBufSize);
+}
+
 void FadeCurves::setPreShape(FadeCurves::Shape x) {
   preShape = x;
   calcPreFade();
@@ -157,3 +182,8 @@ void FadeCurves::setRecShape(FadeCurves::Shape x) {
   recShape = x;
   calcRecFade();
 }
+
+void FadeCurves::setMixShape(FadeCurves::Shape x) {
+  mixShape = x;
+  calcMixGain();
+}
@@ -0,0 +1,41 @@
+#include "softcut/Interpolate.h"
+
+#include <cmath>
+
+using namespace softcut;
+
+// zeroth-order modified bessel function of the first kind, by its series
+static double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+Interpolate::SincTable::SincTable() {
+  // kaiser window shape; trades passband ripple against alias rejection
+  const double beta = 9.0;
+  const double half = MaxPoints / 2;
+  for (int p = 0; p <= SincPhases; ++p) {
+    const double x = static_cast<double>(p) / SincPhases;
+    double w[MaxPoints];
+    double sum = 0.0;
+    for (int k = 0; k < MaxPoints; ++k) {
+      // distance from the interpolated point to point k
+      const double t = k - (half - 1) - x;
+      const double s = t == 0.0 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+      const double r = t / half;
+      w[k] = s * besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) /
+             besselI0(beta);
+      sum += w[k];
+    }
+    for (int k = 0; k < MaxPoints; ++k) {
+      c[p][k] = static_cast<float>(w[k] / sum);
+    }
+  }
+}
+
+const Interpolate::SincTable Interpolate::sincTable;
@@ -4,6 +4,7 @@
 
 #include "softcut/ReadWriteHead.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <limits>
@@ -17,79 +18,462 @@ using namespace std;
 void ReadWriteHead::init(FadeCurves *fc) {
   start = 0.f;
   end = 0.f;
+  headStart = subphase_t(start);
+  headEnd = subphase_t(end);
   active = 0;
   rate = 1.f;
   setFadeTime(0.1f);
   testBuf.init();
   queuedCrossfade = 0;
   queuedCrossfadeFlag = false;
+  fadeCurves = fc;
   head[0].init(fc);
   head[1].init(fc);
+  head[0].setRate(rate);
+  head[1].setRate(rate);
+  resamp.setPhase(0);
+  resamp.setRate(1.0);
+  resampRate = 1.0;
+  resampStartPhase = 0;
+  numWraps = 0;
+  wrapping = false;
+  recOnceDoneFrame = 0;
 
   setRecOnceFlag(false);
 }
 
-void ReadWriteHead::processSample(sample_t in, sample_t *out) {
-  *out =
-      mixFade(head[0].peek(), head[1].peek(), head[0].fade(), head[1].fade());
+void ReadWriteHead::processBlock(const float *rateIn, const float *preIn,
+                                 const float *recIn, const sample_t *in,
+                                 sample_t *out, int numFrames, bool read,
+                                 bool write) {
+  // rec-once can't start mid-block, and loop flag only changes between blocks
+  const int k = (read ? 1 : 0) | (write ? 2 : 0) |
+                (getRecOnceActive() ? 4 : 0) | (loopFlag ? 8 : 0);
+  resampStartPhase = resamp.getPhase();
+  numWraps = 0;
+  recOnceDoneFrame = 0;
+  (this->*kernels[k])(rateIn, preIn, recIn, in, out, numFrames);
+}
 
-  //  assert(!(head[0].state_ == Playing && head[1].state_ == Playing)
-  //  /*multiple active heads*/);
+void ReadWriteHead::followBlock(const ReadWriteHead &lead, const sample_t *in,
+                                sample_t *out, int numFrames, bool read,
+                                bool write) {
+  head[0].copyBlock(lead.head[0], numFrames);
+  head[1].copyBlock(lead.head[1], numFrames);
+  std::copy_n(lead.rateBuf.data(), numFrames, rateBuf.data());
+  std::copy_n(lead.wraps.data(), lead.numWraps, wraps.data());
+  numWraps = lead.numWraps;
+  // the resampler produces as many frames as the leader's did
+  resamp.setPhase(lead.resampStartPhase);
+  const int k = (read ? 1 : 0) | (write ? 2 : 0);
+  (this->*mixKernels[k])(in, out, numFrames);
+
+  // end in the leader's state, so this head carries on from there if
+  // it stops following
+  active = lead.active;
+  if (rate != lead.rate) {
+    rate = lead.rate;
+    calcFadeInc();
+  }
+  pre = lead.pre;
+  rec = lead.rec;
+  head[0].copyState(lead.head[0]);
+  head[1].copyState(lead.head[1]);
+}
 
-  if (recOnceFlag || recOnceDone || (recOnceHead > -1)) {
-    if (recOnceHead > -1) {
-      head[recOnceHead].poke(in, pre, rec);
+const ReadWriteHead::MixKernel ReadWriteHead::mixKernels[4] = {
+    &ReadWriteHead::mixBlock<false, false>,
+    &ReadWriteHead::mixBlock<true, false>,
+    &ReadWriteHead::mixBlock<false, true>,
+    &ReadWriteHead::mixBlock<true, true>,
+};
+
+const ReadWriteHead::Kernel ReadWriteHead::kernels[16] = {
+    &ReadWriteHead::processKernel<false, false, false, false>,
+    &ReadWriteHead::processKernel<true, false, false, false>,
+    &ReadWriteHead::processKernel<false, true, false, false>,
+    &ReadWriteHead::processKernel<true, true, false, false>,
+    &ReadWriteHead::processKernel<false, false, true, false>,
+    &ReadWriteHead::processKernel<true, false, true, false>,
+    &ReadWriteHead::processKernel<false, true, true, false>,
+    &ReadWriteHead::processKernel<true, true, true, false>,
+    &ReadWriteHead::processKernel<false, false, false, true>,
+    &ReadWriteHead::processKernel<true, false, false, true>,
+    &ReadWriteHead::processKernel<false, true, false, true>,
+    &ReadWriteHead::processKernel<true, true, false, true>,
+    &ReadWriteHead::processKernel<false, false, true, true>,
+    &ReadWriteHead::processKernel<true, false, true, true>,
+    &ReadWriteHead::processKernel<false, true, true, true>,
+    &ReadWriteHead::processKernel<true, true, true, true>,
+};
+
+template <bool Read, bool Write, bool RecOnce, bool Loop>
+void ReadWriteHead::processKernel(const float *rateIn, const float *preIn,
+                                  const float *recIn, const sample_t *in,
+                                  sample_t *out, int numFrames) {
+  updateBlock<Write, RecOnce, Loop>(rateIn, preIn, recIn, numFrames);
+  mixBlock<Read, Write>(in, out, numFrames);
+}
+
+template <bool Write, bool RecOnce, bool Loop>
+void ReadWriteHead::updateBlock(const float *rateIn, const float *preIn,
+                                const float *recIn, int numFrames) {
+  head[0].beginBlock();
+  head[1].beginBlock();
+
+  int i = 0;
+  while (i < numFrames) {
+    if (isSteady()) {
+      i = updateSteady<Write, RecOnce>(rateIn, preIn, recIn, i, numFrames);
+      if (i == numFrames) {
+        break;
+      }
     }
-  } else {
-    head[0].poke(in, pre, rec);
-    head[1].poke(in, pre, rec);
+    updateFrame<Write, RecOnce, Loop>(rateIn, preIn, recIn, i++);
   }
+}
 
-  takeAction(head[0].updatePhase(start, end, loopFlag));
-  takeAction(head[1].updatePhase(start, end, loopFlag));
+template <bool Write, bool RecOnce, bool Loop>
+void ReadWriteHead::updateFrame(const float *rateIn, const float *preIn,
+                                const float *recIn, int i) {
+  if (rateIn[i] != rate) {
+    setRate(rateIn[i]);
+  }
+  rateBuf[i] = rate;
+  pre = preIn[i];
+  rec = recIn[i];
+
+  // when recording once, only the subhead that started the pass writes
+  const bool recOnceGate =
+      RecOnce && (recOnceFlag || recOnceDone || (recOnceHead > -1));
+  for (int h = 0; h < 2; ++h) {
+    SubHead &sh = head[h];
+    sh.phaseBuf_[i] = sh.phase_;
+    sh.fadeBuf_[i] = sh.fade_;
+    sh.wrIdxBuf_[i] = -1;
+    if (!Write) {
+      continue;
+    }
+    if (!recOnceGate || recOnceHead == h) {
+      if (sh.state_ == Stopped) {
+        sh.pokeBuf_[i] = PokeFeed;
+      } else {
+        sh.pokeBuf_[i] = PokeWrite;
+        sh.preBuf_[i] =
+            pre + (1.f - pre) * sh.fadeCurves->getPreFadeValue(sh.fade_);
+        sh.recBuf_[i] = rec * sh.fadeCurves->getRecFadeValue(sh.fade_);
+      }
+    } else {
+      sh.pokeBuf_[i] = PokeNone;
+    }
+  }
+
+  takeAction(head[0].updatePhase<Loop>(headStart, headEnd));
+  takeAction(head[1].updatePhase<Loop>(headStart, headEnd));
+  // the active subhead triggers on every frame past the loop point until
+  // its crossfade can start; only the first of these is a new pass
+  const bool trig = head[0].trig_ > 0.f || head[1].trig_ > 0.f;
+  if (trig && !wrapping && numWraps < MaxLoopWraps) {
+    wraps[numWraps++] = {i, queuedCrossfade};
+  }
+  wrapping = trig;
 
   head[0].updateFade(fadeInc);
   head[1].updateFade(fadeInc);
-  dequeueCrossfade();
+  const bool wasRecOnceDone = recOnceDone;
+  if (dequeueCrossfade()) {
+    head[active].wrIdxBuf_[i] = static_cast<int>(head[active].wrIdx_);
+    if (recOnceDone != wasRecOnceDone) {
+      recOnceDoneFrame = i;
+    }
+  }
 }
 
-void ReadWriteHead::processSampleNoRead(sample_t in, sample_t *out) {
-  (void)out;
+template <bool Write, bool RecOnce>
+int ReadWriteHead::updateSteady(const float *rateIn, const float *preIn,
+                                const float *recIn, int i, int numFrames) {
+  // fades and poke modes are constant until the next loop point
+  SubHead &act = head[active];
+  SubHead &idle = head[active ^ 1];
+  const bool recOnceGate =
+      RecOnce && (recOnceFlag || recOnceDone || (recOnceHead > -1));
+  const Poke actPoke =
+      (!recOnceGate || recOnceHead == active) ? PokeWrite : PokeNone;
+  const Poke idlePoke =
+      (!recOnceGate || recOnceHead == (active ^ 1)) ? PokeFeed : PokeNone;
+  const float preFade = act.fadeCurves->getPreFadeValue(act.fade_);
+  const float recFade = act.fadeCurves->getRecFadeValue(act.fade_);
+  act.trig_ = 0.f;
+
+  for (; i < numFrames; ++i) {
+    if (rateIn[i] != rate) {
+      setRate(rateIn[i]);
+    }
+    const subphase_t p = act.phase_ + act.rate_;
+    if (p > headEnd || p < headStart) {
+      // let the full per-frame update handle the loop point
+      break;
+    }
+    rateBuf[i] = rate;
+    pre = preIn[i];
+    rec = recIn[i];
+
+    act.phaseBuf_[i] = act.phase_;
+    act.fadeBuf_[i] = act.fade_;
+    act.wrIdxBuf_[i] = -1;
+    idle.phaseBuf_[i] = idle.phase_;
+    idle.fadeBuf_[i] = idle.fade_;
+    idle.wrIdxBuf_[i] = -1;
+    if (Write) {
+      act.pokeBuf_[i] = actPoke;
+      act.preBuf_[i] = pre + (1.f - pre) * preFade;
+      act.recBuf_[i] = rec * recFade;
+      idle.pokeBuf_[i] = idlePoke;
+    }
+    act.phase_ = p;
+  }
+  return i;
+}
 
-  // BOOST_ASSERT_MSG(!(head[0].state_ == Playing && head[1].state_ == Playing),
-  // "multiple active heads");
-  assert(!(head[0].state_ == Playing && head[1].state_ == Playing));
-  if (recOnceFlag || recOnceDone || (recOnceHead > -1)) {
-    if (recOnceHead > -1) {
-      head[recOnceHead].poke(in, pre, rec);
+template <bool Read, bool Write>
+void ReadWriteHead::mixBlock(const sample_t *in, sample_t *out,
+                             int numFrames) {
+  if (Write && writesAreNoOp(numFrames)) {
+    // the buffer stays as it is, so reads can't be affected
+    if (Read) {
+      readBlock(out, numFrames);
     }
-  } else {
-    head[0].poke(in, pre, rec);
-    head[1].poke(in, pre, rec);
+    skipWrites(in, numFrames);
+    return;
+  }
+  // unless this block's writes can reach its reads,
+  // read the whole block before writing any of it
+  const bool blockRead = Read && !(Write && readHazard(numFrames));
+  if (blockRead) {
+    readBlock(out, numFrames);
+    if (!Write) {
+      return;
+    }
+  }
+  if (Write) {
+    head[0].beginPoke();
+    head[1].beginPoke();
   }
+  for (int i = 0; i < numFrames; ++i) {
+    if (Read && !blockRead) {
+      out[i] = mixFrame(i);
+    }
+    if (Write) {
+      writeFrame(i, in[i]);
+    }
+  }
+  if (Write && mips != nullptr) {
+    updateMips(numFrames);
+  }
+}
 
-  takeAction(head[0].updatePhase(start, end, loopFlag));
-  takeAction(head[1].updatePhase(start, end, loopFlag));
+bool ReadWriteHead::readsMips(int numFrames) {
+  if (mips == nullptr) {
+    return false;
+  }
+  for (int i = 0; i < numFrames; ++i) {
+    if (std::fabs(rateBuf[i]) > 1) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  head[0].updateFade(fadeInc);
-  head[1].updateFade(fadeInc);
-  dequeueCrossfade();
+void ReadWriteHead::updateMips(int numFrames) {
+  for (const SubHead &sh : head) {
+    // runs of write positions, estimated from the read phase and the record
+    // offset, and broken where the head jumps
+    phase_t lo = 0, hi = 0, prev = 0;
+    rate_t maxRate = 1;
+    bool run = false;
+    auto flush = [&] {
+      // the resampler delays its output by a few input frames
+      const phase_t margin = (sh.readsAfter() + 2) * maxRate + 8;
+      mips->update(static_cast<long>(std::floor(lo - margin)),
+                   static_cast<long>(std::ceil(hi + margin)));
+      run = false;
+      maxRate = 1;
+    };
+    for (int i = 0; i < numFrames; ++i) {
+      if (sh.pokeBuf_[i] != PokeWrite) {
+        continue;
+      }
+      const rate_t r = std::fabs(rateBuf[i]);
+      const phase_t p = sh.phaseBuf_[i] + fsign(rateBuf[i]) * sh.recOffset_;
+      if (run && std::fabs(p - prev) > r + 2) {
+        flush();
+      }
+      if (!run) {
+        lo = hi = p;
+        run = true;
+      }
+      lo = std::min(lo, p);
+      hi = std::max(hi, p);
+      maxRate = std::max(maxRate, r);
+      prev = p;
+    }
+    if (run) {
+      flush();
+    }
+  }
 }
 
-void ReadWriteHead::processSampleNoWrite(sample_t in, sample_t *out) {
-  (void)in;
-  *out =
-      mixFade(head[0].peek(), head[1].peek(), head[0].fade(), head[1].fade());
+bool ReadWriteHead::writesAreNoOp(int numFrames) {
+  if (!skipIdle) {
+    return false;
+  }
+  for (const SubHead &sh : head) {
+    for (int i = 0; i < numFrames; ++i) {
+      if (sh.pokeBuf_[i] == PokeWrite &&
+          (sh.preBuf_[i] != 1.f || sh.recBuf_[i] != 0.f)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
-  // assert(!(head[0].state_ == Playing && head[1].state_ == Playing) /*multiple
-  // active heads*/);
+void ReadWriteHead::skipWrites(const sample_t *in, int numFrames) {
+  head[0].beginPoke();
+  head[1].beginPoke();
+  for (int i = 0; i < numFrames; ++i) {
+    int nframes = 0;
+    if (head[0].pokeBuf_[i] != PokeNone || head[1].pokeBuf_[i] != PokeNone) {
+      setResampRate(rateBuf[i]);
+      nframes = resamp.skipFrame(in[i]);
+    }
+    head[0].skipPoke(i, nframes, rateBuf[i]);
+    head[1].skipPoke(i, nframes, rateBuf[i]);
+  }
+}
 
-  takeAction(head[0].updatePhase(start, end, loopFlag));
-  takeAction(head[1].updatePhase(start, end, loopFlag));
+bool ReadWriteHead::readHazard(int numFrames) {
+  phase_t lo[2], hi[2];
+  bool audible[2];
+  for (int h = 0; h < 2; ++h) {
+    const SubHead &sh = head[h];
+    lo[h] = hi[h] = sh.phaseBuf_[0];
+    audible[h] = false;
+    for (int i = 0; i < numFrames; ++i) {
+      lo[h] = std::min(lo[h], static_cast<phase_t>(sh.phaseBuf_[i]));
+      hi[h] = std::max(hi[h], static_cast<phase_t>(sh.phaseBuf_[i]));
+      audible[h] |= sh.fadeBuf_[i] > 0.f;
+    }
+  }
 
-  head[0].updateFade(fadeInc);
-  head[1].updateFade(fadeInc);
-  dequeueCrossfade();
+  for (int w = 0; w < 2; ++w) {
+    const SubHead &sh = head[w];
+    bool writes = false;
+    bool cut = false;
+    bool fwd = true;
+    bool rev = true;
+    rate_t maxRate = 0;
+    for (int i = 0; i < numFrames; ++i) {
+      writes |= sh.pokeBuf_[i] == PokeWrite;
+      cut |= sh.wrIdxBuf_[i] >= 0;
+      fwd &= rateBuf[i] > 0;
+      rev &= rateBuf[i] < 0;
+      maxRate = std::max(maxRate, std::fabs(rateBuf[i]));
+    }
+    if (!writes) {
+      continue;
+    }
+    if (cut || !(fwd || rev)) {
+      return true;
+    }
+    // against its own reads:
+    // safe while the write position trails the read position
+    const auto frames = static_cast<long>(sh.bufFrames_);
+    long trail = static_cast<long>(sh.phaseBuf_[0]) -
+                 static_cast<long>(sh.wrIdxStart_);
+    trail = ((trail % frames) + frames) % frames;
+    if (trail > frames / 2) {
+      trail -= frames;
+    }
+    const int reach = fwd ? sh.readsBefore() : sh.readsAfter();
+    if ((fwd ? trail : -trail) < reach + 3) {
+      return true;
+    }
+    // against the other subhead's reads: the regions must be apart
+    const int r = w ^ 1;
+    // kernels wider than hermite also delay the resampler output,
+    // and above unity rate each frame writes a run of `rate` frames
+    const phase_t margin = std::abs(sh.recOffset_) + 4 +
+                           std::max(sh.readsAfter() - 2, 0) +
+                           std::max(std::ceil(maxRate) - 1, 0.0);
+    const phase_t wlo = lo[w] - margin;
+    const phase_t whi = hi[w] + margin;
+    if (wlo < 0 || whi >= static_cast<phase_t>(frames)) {
+      return true;
+    }
+    if (audible[r] && lo[r] - head[r].readsBefore() <= whi &&
+        hi[r] + head[r].readsAfter() + 1 >= wlo) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ReadWriteHead::readBlock(sample_t *out, int numFrames) {
+  // stopped subheads contribute nothing, so skip reading them
+  bool audible[2] = {false, false};
+  // and a subhead at full level for the whole block plays as is
+  bool steady[2] = {true, true};
+  for (int h = 0; h < 2; ++h) {
+    for (int i = 0; i < numFrames; ++i) {
+      audible[h] |= head[h].fadeBuf_[i] > 0.f;
+      steady[h] &= head[h].fadeBuf_[i] == 1.f;
+    }
+  }
+  const bool mip = readsMips(numFrames);
+  auto peekBlock = [&](int h, sample_t *dst) {
+    if (mip) {
+      head[h].peekMipBlock(dst, rateBuf.data(), numFrames);
+    } else {
+      head[h].peekBlock(dst, numFrames);
+    }
+  };
+  for (int h = 0; h < 2; ++h) {
+    if (steady[h] && !audible[h ^ 1]) {
+      peekBlock(h, out);
+      return;
+    }
+  }
+  for (int h = 0; h < 2; ++h) {
+    if (audible[h]) {
+      peekBlock(h, readBuf[h].data());
+    }
+  }
+
+  // fade levels are mostly constant, so only recompute gains on change
+  float fade[2] = {-1.f, -1.f};
+  float gain[2] = {0.f, 0.f};
+  auto updateGain = [&](int h, int i) {
+    if (head[h].fadeBuf_[i] != fade[h]) {
+      fade[h] = head[h].fadeBuf_[i];
+      gain[h] = fadeCurves->getMixGain(fade[h]);
+    }
+  };
+  if (audible[0] && audible[1]) {
+    for (int i = 0; i < numFrames; ++i) {
+      updateGain(0, i);
+      updateGain(1, i);
+      out[i] = readBuf[0][i] * gain[0] + readBuf[1][i] * gain[1];
+    }
+  } else if (audible[0] || audible[1]) {
+    const int h = audible[0] ? 0 : 1;
+    for (int i = 0; i < numFrames; ++i) {
+      updateGain(h, i);
+      out[i] = readBuf[h][i] * gain[h];
+    }
+  } else {
+    std::fill_n(out, numFrames, static_cast<sample_t>(0));
+  }
 }
 
 void ReadWriteHead::setRate(rate_t x) {
@@ -101,11 +485,13 @@ void ReadWriteHead::setRate(rate_t x) {
 
 void ReadWriteHead::setLoopStartSeconds(float x) {
   start = x * sr;
+  headStart = subphase_t(start);
   queuedCrossfadeFlag = false;
 }
 
 void ReadWriteHead::setLoopEndSeconds(float x) {
   end = x * sr;
+  headEnd = subphase_t(end);
   queuedCrossfadeFlag = false;
 }
 
@@ -130,14 +516,17 @@ void ReadWriteHead::enqueueCrossfade(phase_t pos) {
   queuedCrossfadeFlag = true;
 }
 
-void ReadWriteHead::dequeueCrossfade() {
+bool ReadWriteHead::dequeueCrossfade() {
   State s = head[active].state();
+  bool didCut = false;
   if (!(s == State::FadeIn || s == State::FadeOut)) {
     if (queuedCrossfadeFlag) {
       cutToPhase(queuedCrossfade);
+      didCut = true;
     }
     queuedCrossfadeFlag = false;
   }
+  return didCut;
 }
 
 void ReadWriteHead::cutToPhase(phase_t pos) {
@@ -188,6 +577,12 @@ void ReadWriteHead::setBuffer(sample_t *b, uint32_t bf) {
   head[1].setBuffer(b, bf);
 }
 
+void ReadWriteHead::setMipmap(Mipmap *m) {
+  mips = m;
+  head[0].setMipmap(m);
+  head[1].setMipmap(m);
+}
+
 void ReadWriteHead::setLoopFlag(bool val) { loopFlag = val; }
 
 void ReadWriteHead::setRecOnceFlag(bool val) {
@@ -204,14 +599,11 @@ bool ReadWriteHead::getRecOnceActive() {
 
 void ReadWriteHead::setSampleRate(float sr_) {
   sr = sr_;
+  calcFadeInc();
   head[0].setSampleRate(sr);
   head[1].setSampleRate(sr);
 }
 
-sample_t ReadWriteHead::mixFade(sample_t x, sample_t y, float a, float b) {
-  return x * sinf(a * (float)M_PI_2) + y * sinf(b * (float)M_PI_2);
-}
-
 void ReadWriteHead::setRec(float x) { rec = x; }
 
 void ReadWriteHead::setPre(float x) { pre = x; }
@@ -229,6 +621,122 @@ void ReadWriteHead::cutToPos(float seconds) {
 
 rate_t ReadWriteHead::getRate() { return rate; }
 
+int ReadWriteHead::getEntryFrame(phase_t lo, phase_t hi, int numFrames) {
+  // before a cut to it, the active subhead is silent and its phase stale
+  const SubHead &h = head[active];
+  int i = numFrames;
+  while (i > 0 && h.fadeBuf_[i - 1] > 0.f && h.phaseBuf_[i - 1] >= lo &&
+         h.phaseBuf_[i - 1] < hi) {
+    --i;
+  }
+  return i;
+}
+
+// distance between phases, around a buffer of `frames`
+static inline phase_t wrappedDistance(phase_t a, phase_t b, phase_t frames) {
+  const phase_t d = std::fmod(std::fabs(a - b), frames);
+  return std::min(d, frames - d);
+}
+
+bool ReadWriteHead::duckGain(const ReadWriteHead &ref, phase_t window,
+                             float *gain, int numFrames) {
+  const auto frames = static_cast<phase_t>(head[0].bufFrames_);
+  if (window <= 0) {
+    return false;
+  }
+  // where the reference head wrote, for each subhead and frame
+  phase_t wr[2][maxBlockFrames];
+  phase_t rlo = frames, rhi = -frames, wlo = frames, whi = -frames;
+  for (int h = 0; h < 2; ++h) {
+    const SubHead &r = head[h];
+    const SubHead &w = ref.head[h];
+    for (int i = 0; i < numFrames; ++i) {
+      if (r.fadeBuf_[i] > 0.f) {
+        rlo = std::min(rlo, static_cast<phase_t>(r.phaseBuf_[i]));
+        rhi = std::max(rhi, static_cast<phase_t>(r.phaseBuf_[i]));
+      }
+      if (w.pokeBuf_[i] == PokeWrite) {
+        const phase_t p = w.phaseBuf_[i] + fsign(ref.rateBuf[i]) * w.recOffset_;
+        wr[h][i] = p;
+        wlo = std::min(wlo, p);
+        whi = std::max(whi, p);
+      }
+    }
+  }
+  if (rlo > rhi || wlo > whi) {
+    return false;
+  }
+  // reads and writes usually stay far apart for the whole block
+  if (rhi - rlo + whi - wlo + 2 * window < frames) {
+    const phase_t gap = wrappedDistance((rlo + rhi) / 2, (wlo + whi) / 2,
+                                        frames) -
+                        (rhi - rlo + whi - wlo) / 2;
+    if (gap >= window) {
+      return false;
+    }
+  }
+  for (int i = 0; i < numFrames; ++i) {
+    phase_t d = window;
+    for (int h = 0; h < 2; ++h) {
+      if (head[h].fadeBuf_[i] <= 0.f) {
+        continue;
+      }
+      for (int k = 0; k < 2; ++k) {
+        if (ref.head[k].pokeBuf_[i] == PokeWrite) {
+          d = std::min(d,
+                       wrappedDistance(head[h].phaseBuf_[i], wr[k][i], frames));
+        }
+      }
+    }
+    gain[i] = fadeCurves->getMixGain(static_cast<float>(d / window));
+  }
+  return true;
+}
+
+void ReadWriteHead::getBlockSpan(rate_t maxRate, int numFrames, phase_t &lo,
+                                 phase_t &hi) {
+  lo = hi = head[active].phase_;
+  auto include = [&](phase_t p) {
+    lo = std::min(lo, p);
+    hi = std::max(hi, p);
+  };
+  for (auto &h : head) {
+    if (h.state_ != Stopped) {
+      include(h.phase_);
+    }
+  }
+  // a head may jump to a queued position or a loop point during the block
+  if (queuedCrossfadeFlag) {
+    include(queuedCrossfade);
+  }
+  if (loopFlag) {
+    include(start);
+    include(end);
+  }
+  // then travel; writes trail reads by the record offset, and the
+  // interpolator and resampler reach a few frames further
+  const phase_t reach = maxRate * (numFrames + 1) +
+                        std::max(std::abs(head[0].recOffset_),
+                                 std::abs(head[1].recOffset_)) +
+                        head[0].readsAfter() + 6;
+  lo -= reach;
+  hi += reach;
+  // mip level reads and updates reach further, more so for the updates'
+  // allowance for resampler delay
+  if (mips != nullptr) {
+    const phase_t mipReach =
+        Mipmap::Reach + (head[0].readsAfter() + 2) * maxRate + 8;
+    lo -= mipReach;
+    hi += mipReach;
+  }
+}
+
+void ReadWriteHead::setInterpolation(Interpolate::Quality q) {
+  head[0].setQuality(q);
+  head[1].setQuality(q);
+  resamp.setQuality(q);
+}
+
 void ReadWriteHead::setRecOffsetSamples(int d) {
   head[0].setRecOffsetSamples(d);
   head[1].setRecOffsetSamples(d);
@@ -6,7 +6,9 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
 
 #include "softcut/FadeCurves.h"
@@ -18,143 +20,105 @@ using namespace softcut;
 
 void SubHead::init(FadeCurves *fc) {
   fadeCurves = fc;
-  phase_ = 0;
+  phase_ = subphase_t(0);
   fade_ = 0;
   trig_ = 0;
   state_ = Stopped;
-  resamp_.setPhase(0);
   inc_dir_ = 1;
   recOffset_ = -8;
 }
 
-Action SubHead::updatePhase(phase_t start, phase_t end, bool loop) {
-  Action res = None;
-  trig_ = 0.f;
-  phase_t p;
-  switch (state_) {
-    case FadeIn:
-    case FadeOut:
-    case Playing:
-      p = phase_ + rate_;
-      if (active_) {
-        // FIXME: should refactor this a bit.
-        if (rate_ > 0.f) {
-          if (p > end || p < start) {
-            if (loop) {
-              trig_ = 1.f;
-              res = LoopPos;
-            } else {
-              state_ = FadeOut;
-              res = Stop;
-            }
-          }
-        } else {  // negative rate
-          if (p > end || p < start) {
-            if (loop) {
-              trig_ = 1.f;
-              res = LoopNeg;
-            } else {
-              state_ = FadeOut;
-              res = Stop;
-            }
-          }
-        }  // rate sign check
-      }  // /active check
-      phase_ = p;
+void SubHead::peekBlock(sample_t *out, int numFrames) {
+  switch (quality_) {
+    case Interpolate::Linear:
+      peekBlockWith<Interpolate::Linear>(out, numFrames);
       break;
-    case Stopped:
-    default:;
-      ;  // nothing to do
-  }
-  return res;
-}
-
-void SubHead::updateFade(float inc) {
-  switch (state_) {
-    case FadeIn:
-      fade_ += inc;
-      if (fade_ > 1.f) {
-        fade_ = 1.f;
-        state_ = Playing;
-      }
+    case Interpolate::SixPoint:
+      peekBlockWith<Interpolate::SixPoint>(out, numFrames);
       break;
-    case FadeOut:
-      fade_ -= inc;
-      if (fade_ < 0.f) {
-        fade_ = 0.f;
-        state_ = Stopped;
-      }
+    case Interpolate::Sinc:
+      peekBlockWith<Interpolate::Sinc>(out, numFrames);
+      break;
+    default:
+      peekBlockWith<Interpolate::Hermite>(out, numFrames);
       break;
-    case Playing:
-    case Stopped:
-    default:;
-      ;  // nothing to do
   }
 }
 
-#if 0
-/// test: no resampling
-void Subhead::poke(sample_t in, float pre, float rec, int numFades) {
-    sample_t* p = &buf_[static_cast<unsigned int>(phase_)&bufMask_];
-    *p *= pre;
-    *p += (in * rec);
-}
+template <Interpolate::Quality Q>
+void SubHead::peekBlockWith(sample_t *out, int numFrames) {
+#ifdef SOFTCUT_FIXED_PHASE
+  // indices always wrap with a mask, so there is no contiguous special case
+  for (int i = 0; i < numFrames; ++i) {
+    out[i] = peekAt<Q>(phaseBuf_[i]);
+  }
 #else
-void SubHead::poke(sample_t in, float pre, float rec) {
-  // FIXME: since there's never really a reason to not push input, or to reset
-  // input ringbuf, it follows that all resamplers could share an input ringbuf
-  int nframes = resamp_.processFrame(in);
-
-  if (state_ == Stopped) {
+  constexpr int points = Interpolate::Kernel<Q>::points;
+  phase_t lo = phaseBuf_[0];
+  phase_t hi = lo;
+  for (int i = 1; i < numFrames; ++i) {
+    lo = std::min(lo, phaseBuf_[i]);
+    hi = std::max(hi, phaseBuf_[i]);
+  }
+  // contiguous fast path, when no index needs wrapping
+  if (lo >= points / 2 - 1 &&
+      hi + points / 2 + 1 < static_cast<phase_t>(bufFrames_)) {
+    if (Q == Interpolate::Hermite) {
+      Interpolate::hermiteBlock(buf_, phaseBuf_.data(), out, numFrames);
+      return;
+    }
+    for (int i = 0; i < numFrames; ++i) {
+      const int i1 = static_cast<int>(phaseBuf_[i]);
+      const auto x =
+          static_cast<sample_t>(phaseBuf_[i] - static_cast<phase_t>(i1));
+      out[i] = Interpolate::Kernel<Q>::interp(x, buf_ + i1 - (points / 2 - 1));
+    }
     return;
   }
-
-  // assert(fade_ >= 0.f && fade_ <= 1.f /* bad fade coefficient in poke() */);
-
-  preFade_ = pre + (1.f - pre) * fadeCurves->getPreFadeValue(fade_);
-  recFade_ = rec * fadeCurves->getRecFadeValue(fade_);
-
-  sample_t y;  // write value
-  const sample_t *src = resamp_.output();
-
-  for (int i = 0; i < nframes; ++i) {
-    y = src[i];
-
-#if 1  // soft clipper
-    y = clip_.processSample(y);
-#endif
-#if 0  // lowpass filter
-        lpf_.processSample(&y);
+  for (int i = 0; i < numFrames; ++i) {
+    out[i] = peekAt<Q>(phaseBuf_[i]);
+  }
 #endif
-    buf_[wrIdx_] *= preFade_;
-    buf_[wrIdx_] += y * recFade_;
+}
 
-    wrIdx_ = wrapBufIndex(wrIdx_ + inc_dir_);
+void SubHead::peekMipBlock(sample_t *out, const rate_t *rate, int numFrames) {
+  // the rate is mostly constant over a block, so only look up the level on
+  // a change
+  rate_t r = -1;
+  int L = 0;
+  sample_t f = 0;
+  for (int i = 0; i < numFrames; ++i) {
+    const rate_t a = std::fabs(rate[i]);
+    if (a != r) {
+      r = a;
+      mipLevel(r, L, f);
+    }
+    out[i] = peekMipAt(i, L, f);
   }
 }
-#endif
 
-sample_t SubHead::peek() { return peek4(); }
-
-sample_t SubHead::peek4() {
-  int phase1 = static_cast<int>(phase_);
-  int phase0 = phase1 - 1;
-  int phase2 = phase1 + 1;
-  int phase3 = phase1 + 2;
-
-  sample_t y0 = buf_[wrapBufIndex(phase0)];
-  sample_t y1 = buf_[wrapBufIndex(phase1)];
-  sample_t y3 = buf_[wrapBufIndex(phase3)];
-  sample_t y2 = buf_[wrapBufIndex(phase2)];
-
-  auto x = static_cast<sample_t>(phase_ - (sample_t)phase1);
-  return Interpolate::hermite<sample_t>(x, y0, y1, y2, y3);
+void SubHead::copyBlock(const SubHead &lead, int numFrames) {
+  std::copy_n(lead.phaseBuf_.data(), numFrames, phaseBuf_.data());
+  std::copy_n(lead.fadeBuf_.data(), numFrames, fadeBuf_.data());
+  std::copy_n(lead.preBuf_.data(), numFrames, preBuf_.data());
+  std::copy_n(lead.recBuf_.data(), numFrames, recBuf_.data());
+  std::copy_n(lead.pokeBuf_.data(), numFrames, pokeBuf_.data());
+  // write positions are masked, in case this buffer is the shorter one
+  for (int i = 0; i < numFrames; ++i) {
+    const int w = lead.wrIdxBuf_[i];
+    wrIdxBuf_[i] = w < 0 ? w : static_cast<int>(w & bufMask_);
+  }
+  wrIdxStart_ = lead.wrIdxStart_ & bufMask_;
 }
 
-unsigned int SubHead::wrapBufIndex(int x) {
-  x += bufFrames_;
-  // assert(x >= 0 /* buffer index before masking is non-negative */);
-  return x & bufMask_;
+void SubHead::copyState(const SubHead &lead) {
+  state_ = lead.state_;
+  rate_ = lead.rate_;
+  inc_dir_ = lead.inc_dir_;
+  phase_ = lead.phase_;
+  fade_ = lead.fade_;
+  trig_ = lead.trig_;
+  active_ = lead.active_;
 }
 
 void SubHead::setSampleRate(float sr) {
@@ -162,13 +126,8 @@ void SubHead::setSampleRate(float sr) {
 }
 
 void SubHead::setPhase(phase_t phase) {
-  phase_ = phase;
-  wrIdx_ = wrapBufIndex(static_cast<int>(phase_) + (inc_dir_ * recOffset_));
-
-  // NB: not resetting the resampler here:
-  // - it's ok to keep history of input when changing positions.
-  // - resamp output doesn't need clearing b/c we write/read from beginning on
-  // each sample anyway
+  phase_ = subphase_t(phase);
+  wrIdx_ = wrapBufIndex(static_cast<int>(phase) + (inc_dir_ * recOffset_));
 }
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -182,12 +141,9 @@ void SubHead::setBuffer(sample_t *buf, unsigned int frames) {
 }
 
 void SubHead::setRate(rate_t rate) {
-  rate_ = rate;
+  rate_ = subphase_t(rate);
   inc_dir_ = fsign(rate);
-  // NB: resampler doesn't handle negative rates.
-  // instead we copy the resampler output backwards into the buffer when rate <
-  // 0.
-  resamp_.setRate(std::fabs(rate));
+  // NB: the resampler rate is updated per frame, as the head writes
 }
 
 void SubHead::setState(State state) {
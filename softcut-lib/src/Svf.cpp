@@ -6,7 +6,25 @@
 
 #include <math.h>
 
-const float Svf::MAX_NORM_FC = 0.4;
+#include <algorithm>
+
+static constexpr float maxNormFc = 0.4f;
+const float Svf::MAX_NORM_FC = maxNormFc;
+
+namespace {
+// tan(pi * w) at evenly spaced normalized frequencies w in [0, maxNormFc].
+// linear interpolation between entries is within 2e-5 of tan(), relative
+struct WarpTable {
+  static constexpr int size = 512;
+  float g[size + 1];
+  WarpTable() {
+    for (int i = 0; i <= size; ++i) {
+      g[i] = static_cast<float>(tan(M_PI * maxNormFc * i / size));
+    }
+  }
+};
+const WarpTable warpTable;
+}  // namespace
 
 Svf::Svf() = default;
 
@@ -20,6 +38,7 @@ void Svf::setSampleRate(float aSr) {
   pi_sr = M_PI / sr;
   minFc = 10.f;
   maxFc = sr * MAX_NORM_FC;
+  warpScale = WarpTable::size / maxFc;
   calcWarp();
   calcCoeffs();
 }
@@ -31,18 +50,52 @@ void Svf::setFc(float aFc) {
   calcCoeffs();
 }
 
+void Svf::setFcFast(float aFc) {
+  fc = (aFc > maxFc) ? maxFc : aFc;
+  fc = (fc < minFc) ? minFc : fc;
+  const float x = fc * warpScale;
+  const int i = std::min(static_cast<int>(x), WarpTable::size - 1);
+  const float f = x - i;
+  g = warpTable.g[i] + f * (warpTable.g[i + 1] - warpTable.g[i]);
+  calcCoeffs();
+}
+
 void Svf::setRq(float aRq) {
   rq = aRq;
   calcCoeffs();
 }
 
-void Svf::setLpMix(float mix) { lpMix = mix; }
+void Svf::setLpMix(float mix) {
+  lpMix = mix;
+  updateMode();
+}
 
-void Svf::setHpMix(float mix) { hpMix = mix; }
+void Svf::setHpMix(float mix) {
+  hpMix = mix;
+  updateMode();
+}
 
-void Svf::setBpMix(float mix) { bpMix = mix; }
+void Svf::setBpMix(float mix) {
+  bpMix = mix;
+  updateMode();
+}
 
-void Svf::setBrMix(float mix) { brMix = mix; }
+void Svf::setBrMix(float mix) {
+  brMix = mix;
+  updateMode();
+}
+
+void Svf::updateMode() {
+  if (bpMix != 0.f || brMix != 0.f || (lpMix != 0.f && hpMix != 0.f)) {
+    mode = Mix;
+  } else if (lpMix != 0.f) {
+    mode = LowPass;
+  } else if (hpMix != 0.f) {
+    mode = HighPass;
+  } else {
+    mode = Bypass;
+  }
+}
 
 void Svf::reset() { clearState(); }
 
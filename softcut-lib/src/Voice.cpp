@@ -4,7 +4,8 @@
 
 #include "softcut/Voice.h"
 
-#include <functional>
+#include <algorithm>
+#include <cmath>
 
 #include "softcut/Resampler.h"
 
@@ -39,9 +40,15 @@ void Voice::reset() {
   svfPostDryLevel = 1.0;
 
   rateRamp.reset(1.0);
+  rateMoving = false;
   recRamp.reset(0.0);
   preRamp.reset(0.0);
 
+  leader = nullptr;
+  activeLeader = nullptr;
+  duckRef = nullptr;
+  activeDuckRef = nullptr;
+
   setFadeTime(0.01);
   setRecPreSlewTime(0.001);
   setRateSlewTime(0.001);
@@ -52,63 +59,171 @@ void Voice::reset() {
   playFlag = false;
 
   sch.init(&fadeCurves);
+  sch.setInterpolation(Interpolate::Hermite);
 }
 
 void Voice::processBlockMono(const sample_t* in, sample_t* out, int numFrames) {
-  std::function<void(sample_t, sample_t*)> sampleFunc;
-  if (playFlag) {
-    if (recFlag) {
-      sampleFunc = [this](sample_t in, sample_t* out) {
-        this->sch.processSample(in, out);
-      };
-    } else {
-      sampleFunc = [this](sample_t in, sample_t* out) {
-        this->sch.processSampleNoWrite(in, out);
-      };
-    }
-  } else {
-    if (recFlag) {
-      sampleFunc = [this](sample_t in, sample_t* out) {
-        this->sch.processSampleNoRead(in, out);
-      };
-    } else {
-      sampleFunc = [](sample_t in, sample_t* out) {
-        (void)in;
-        // makes sure the output bus is zeroed
-        *out = static_cast<sample_t>(0);
-      };
+  // the leader's and the duck reference's blocks come right before this one
+  linkActive(true, true);
+  clearEvents();
+  eventOffset = 0;
+  while (numFrames > 0) {
+    const int n = std::min(numFrames, maxBlockFrames);
+    processFrames(in, out, n);
+    in += n;
+    out += n;
+    numFrames -= n;
+    eventOffset += n;
+  }
+}
+
+// true if every frame is zero
+static bool isSilent(const sample_t* x, int numFrames) {
+  for (int i = 0; i < numFrames; ++i) {
+    if (x[i] != 0) {
+      return false;
     }
   }
+  return true;
+}
 
-  sample_t x, y;
+// ramp values for a block; a settled ramp just repeats its value
+static void updateRamp(LogRamp& ramp, float* out, int numFrames) {
+  if (skipIdle && ramp.isSettled()) {
+    std::fill_n(out, numFrames, ramp.getValue());
+    return;
+  }
   for (int i = 0; i < numFrames; ++i) {
-    x = svfPre.getNextSample(in[i]) + in[i] * svfPreDryLevel;
-    sch.setRate(rateRamp.update());
-    sch.setPre(preRamp.update());
-    sch.setRec(recRamp.update());
-    sampleFunc(x, &y);
-    out[i] = y;
-    updateQuantPhase();
+    out[i] = ramp.update();
+  }
+}
+
+void Voice::processFrames(const sample_t* in, sample_t* out, int numFrames) {
+  // parameter ramps; a follower's head doesn't use them
+  if (activeLeader == nullptr) {
+    rateMoving = !rateRamp.isSettled();
+    updateRamp(rateRamp, rateBuf.data(), numFrames);
+    updateRamp(preRamp, preBuf.data(), numFrames);
+    updateRamp(recRamp, recBuf.data(), numFrames);
+  }
+
+  // input filter
+  if (preFilterTracking()) {
+    processPreFilterTracking(in, numFrames);
+  } else if (!preFilterIdle(in, numFrames)) {
+    svfPre.process(in, inBuf.data(), svfPreDryLevel, numFrames);
+  }
+
+  processHead(out, numFrames);
+  applyDuck(out, numFrames);
+
+  // add tape fx (bias, pregain)
+  if (!tapeIdle(out, numFrames)) {
+    tapeFx.ProcessMono(out, numFrames);
+  } else if (svfPost.processSilence(out, svfPostDryLevel, numFrames)) {
+    return;
   }
 
+  // add post filter (lpf) after tape fx
+  svfPost.process(out, out, svfPostDryLevel, numFrames);
+}
+
+bool Voice::preFilterIdle(const sample_t* in, int numFrames) {
+  return skipIdle && isSilent(in, numFrames) &&
+         svfPre.processSilence(inBuf.data(), svfPreDryLevel, numFrames);
+}
+
+void Voice::processPreFilterTracking(const sample_t* in, int numFrames) {
+  const auto& rate = (activeLeader != nullptr ? activeLeader : this)->rateBuf;
+  for (int i = 0; i < numFrames; ++i) {
+    preFcBuf[i] = preFilterFc(rate[i]);
+  }
+  if (preFilterIdle(in, numFrames)) {
+    svfPre.setFcFast(preFcBuf[numFrames - 1]);
+    return;
+  }
+  svfPre.processMod(in, inBuf.data(), preFcBuf.data(), svfPreDryLevel,
+                    numFrames);
+}
+
+bool Voice::tapeIdle(const sample_t* out, int numFrames) {
+  return skipIdle && tapeFx.IsSilent<sample_t>() && isSilent(out, numFrames);
+}
+
+void Voice::applyDuck(sample_t* out, int numFrames) {
+  if (activeDuckRef == nullptr || activeDuckRef->buf != buf || !headRead ||
+      !activeDuckRef->headWrite) {
+    return;
+  }
+  if (!sch.duckGain(activeDuckRef->sch, duckTime * sampleRate, duckBuf.data(),
+                    numFrames)) {
+    return;
+  }
+  for (int i = 0; i < numFrames; ++i) {
+    out[i] *= duckBuf[i];
+  }
+}
+
+void Voice::processHead(sample_t* out, int numFrames) {
+  if (activeLeader != nullptr) {
+    // peek/poke/mix only, at the leader's positions
+    headRead = activeLeader->headRead;
+    headWrite = activeLeader->headWrite;
+    if (headRead || headWrite) {
+      sch.followBlock(activeLeader->sch, inBuf.data(), out, numFrames, headRead,
+                      headWrite);
+    }
+    if (!headRead) {
+      std::fill_n(out, numFrames, static_cast<sample_t>(0));
+    }
+    updateEvents(numFrames);
+    rawPhase.store(sch.getActivePhase(), std::memory_order_relaxed);
+    return;
+  }
+
+  headRead = playFlag;
+  headWrite = recFlag;
+  // head positions and fades, then peek/poke/mix
+  if (playFlag || recFlag) {
+    sch.processBlock(rateBuf.data(), preBuf.data(), recBuf.data(),
+                     inBuf.data(), out, numFrames, playFlag, recFlag);
+    if (!playFlag) {
+      // makes sure the output bus is zeroed
+      std::fill_n(out, numFrames, static_cast<sample_t>(0));
+    }
+  } else {
+    sch.setRate(rateBuf[numFrames - 1]);
+    sch.setPre(preBuf[numFrames - 1]);
+    sch.setRec(recBuf[numFrames - 1]);
+    std::fill_n(out, numFrames, static_cast<sample_t>(0));
+  }
+
+  updateEvents(numFrames);
   rawPhase.store(sch.getActivePhase(), std::memory_order_relaxed);
 
   if (recFlag) {
     if (sch.getRecOnceDone()) {
       // record once is finished, turn off recording flag
       // and reset the recording subheads
+      addEvent(VoiceEvent::RecOnceDone, sch.getRecOnceDoneFrame(), 0);
       recFlag = false;
       sch.setRecOnceFlag(false);
     }
   }
+}
 
-  // add tape fx (bias, pregain)
-  tapeFx.ProcessMono(out, numFrames);
-
-  // add post filter (lpf) after tape fx
-  for (int i = 0; i < numFrames; ++i) {
-    out[i] = svfPost.getNextSample(out[i]) + out[i] * svfPostDryLevel;
+bool Voice::getBlockSpan(int numFrames, phase_t& lo, phase_t& hi) {
+  if (activeLeader != nullptr) {
+    return activeLeader->getBlockSpan(numFrames, lo, hi);
+  }
+  if (!playFlag && !recFlag) {
+    return false;
   }
+  // the ramped rate stays between its current value and its target
+  const rate_t r = std::max(std::fabs(rateRamp.getValue()),
+                            std::fabs(rateRamp.getTarget()));
+  sch.getBlockSpan(r, numFrames, lo, hi);
+  return true;
 }
 
 void Voice::setSampleRate(float hz) {
@@ -133,6 +248,20 @@ void Voice::setLoopEnd(float sec) { sch.setLoopEndSeconds(sec); }
 
 void Voice::setFadeTime(float sec) { sch.setFadeTime(sec); }
 
+void Voice::setFadeShape(int shape) {
+  if (shape < FadeCurves::Linear || shape > FadeCurves::Raised) {
+    return;
+  }
+  fadeCurves.setMixShape(static_cast<FadeCurves::Shape>(shape));
+}
+
+void Voice::setInterpolation(int quality) {
+  if (quality < Interpolate::Linear || quality > Interpolate::Sinc) {
+    return;
+  }
+  sch.setInterpolation(static_cast<Interpolate::Quality>(quality));
+}
+
 void Voice::cutToPos(float sec) { sch.cutToPos(sec); }
 
 void Voice::setRecLevel(float amp) { recRamp.setTarget(amp); }
@@ -193,12 +322,13 @@ void Voice::setPreFilterDry(float x) { svfPreDryLevel = x; }
 
 void Voice::setPreFilterFcMod(float x) { svfPreFcMod = x; }
 
+float Voice::preFilterFc(float rate) const {
+  const float fcMod = std::min(svfPreFcBase, svfPreFcBase * std::fabs(rate));
+  return svfPreFcBase + svfPreFcMod * (fcMod - svfPreFcBase);
+}
+
 void Voice::updatePreSvfFc() {
-  float fcMod =
-      std::min(svfPreFcBase,
-               svfPreFcBase * std::fabs(static_cast<float>(sch.getRate())));
-  fcMod = svfPreFcBase + svfPreFcMod * (fcMod - svfPreFcBase);
-  svfPre.setFc(fcMod);
+  svfPre.setFc(preFilterFc(static_cast<float>(sch.getRate())));
 }
 
 // output filter
@@ -223,12 +353,20 @@ void Voice::setRecOnceFlag(bool val) {
   }
 }
 
+void Voice::follow(Voice* lead) { leader = lead; }
+
+void Voice::duck(Voice* ref) { duckRef = ref == this ? nullptr : ref; }
+
+void Voice::setDuckTime(float sec) { duckTime = sec; }
+
 void Voice::setBuffer(sample_t* b, unsigned int nf) {
   buf = b;
   bufFrames = nf;
   sch.setBuffer(buf, bufFrames);
 }
 
+void Voice::setMipmap(Mipmap* mips) { sch.setMipmap(mips); }
+
 void Voice::setRecOffset(float d) {
   sch.setRecOffsetSamples(static_cast<int>(d * sampleRate));
 }
@@ -248,14 +386,43 @@ phase_t Voice::getQuantPhase() {
   return quantPhase.load(std::memory_order_relaxed);
 }
 
-void Voice::updateQuantPhase() {
+void Voice::updateQuantPhase(int numFrames) {
+  const phase_t last = quantPhase.load(std::memory_order_relaxed);
   if (phaseQuant == 0) {
-    quantPhase.store(sch.getActivePhase() / sampleRate,
-                     std::memory_order_relaxed);
-  } else {
-    const phase_t tmp =
-        (sch.getActivePhase() + phaseOffset) / (sampleRate * phaseQuant);
-    quantPhase.store(std::floor(tmp) * phaseQuant, std::memory_order_relaxed);
+    const phase_t q = sch.getActivePhase() / sampleRate;
+    if (q != last) {
+      // no steps to locate; report the position after the block
+      addEvent(VoiceEvent::QuantPhase, numFrames, q);
+      quantPhase.store(q, std::memory_order_relaxed);
+    }
+    return;
+  }
+  const phase_t unit = sampleRate * phaseQuant;
+  const phase_t step = std::floor((sch.getActivePhase() + phaseOffset) / unit);
+  const phase_t q = step * phaseQuant;
+  if (q != last) {
+    // the frame at which the head entered the new step
+    const phase_t lo = step * unit - phaseOffset;
+    const int frame =
+        headRead || headWrite ? sch.getEntryFrame(lo, lo + unit, numFrames) : 0;
+    addEvent(VoiceEvent::QuantPhase, frame, q);
+    quantPhase.store(q, std::memory_order_relaxed);
+  }
+}
+
+void Voice::updateEvents(int numFrames) {
+  if (headRead || headWrite) {
+    for (int k = 0; k < sch.getNumLoopWraps(); ++k) {
+      const ReadWriteHead::LoopWrap& w = sch.getLoopWrap(k);
+      addEvent(VoiceEvent::LoopWrap, w.frame, w.phase / sampleRate);
+    }
+  }
+  updateQuantPhase(numFrames);
+}
+
+void Voice::addEvent(VoiceEvent::Type type, int frame, phase_t value) {
+  if (numEvents < MaxEvents) {
+    events[numEvents++] = {type, eventOffset + frame, value};
   }
 }
 
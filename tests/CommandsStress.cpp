@@ -0,0 +1,232 @@
+// posts queued commands from more threads than there are lanes, so the
+// last lane is shared, while one thread applies them as the audio thread
+// does. every lane is filled to overflowing first, then producers and the
+// consumer run together. checks that each thread's commands arrive in the
+// order posted, none twice, and that exactly those that post() refused
+// are counted as dropped. also checks that commands with indices out of
+// range are refused, that a period applies at most MaxPerPeriod, and that
+// parameters and queued commands are applied in the order posted, and
+// that threads give their lanes back when they exit.
+// meant to be built with ThreadSanitizer
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Commands.h"
+
+using namespace softcut_jack_osc;
+
+namespace {
+
+constexpr int NumThreads = Commands::MaxLanes + 4;
+// phase 1 posts twice what a lane holds, with nothing consuming
+constexpr int FillCommands = 2 * Commands::LaneCapacity;
+constexpr int RunCommands = 20000;
+// a command's value is its thread times this plus its sequence number,
+// which stays exact in a float
+constexpr int Stride = 1 << 16;
+
+// records what was applied, per posting thread
+struct Recorder : Commands::Handler {
+  std::vector<int> seen[NumThreads];
+  int bad = 0;
+  void handleCommand(Commands::CommandPacket *p) override {
+    const int v = static_cast<int>(p->value);
+    const int t = v / Stride;
+    if (p->id != Commands::SET_CUT_POSITION || t < 0 || t >= NumThreads) {
+      ++bad;
+      return;
+    }
+    seen[t].push_back(v % Stride);
+  }
+};
+
+// records the order of what was applied
+struct Sequence : Commands::Handler {
+  std::vector<Commands::Id> ids;
+  void handleCommand(Commands::CommandPacket *p) override {
+    ids.push_back(p->id);
+  }
+};
+
+// all threads wait here until `n` have arrived
+void arrive(std::atomic<int> &count, int n) {
+  count.fetch_add(1);
+  while (count.load() < n) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+int main() {
+  Commands &commands = Commands::softcutCommands;
+  Recorder recorder;
+  std::atomic<int> filled{0};
+  std::atomic<int> producing{NumThreads};
+  int posted[NumThreads] = {};
+  int fillPosted[NumThreads] = {};
+  int refused[NumThreads] = {};
+
+  // out of range: input channel, voice, second voice, buffer. these are
+  // refused before taking a lane, and aren't counted as dropped
+  const bool invalidPosted =
+      commands.post(Commands::SET_LEVEL_IN_CUT, Commands::NumInputs, 0, 1.f) ||
+      commands.post(Commands::SET_CUT_POSITION, Commands::NumVoices, 0.f) ||
+      commands.post(Commands::SET_CUT_VOICE_SYNC, 0, -1, 0.f) ||
+      commands.post(Commands::SET_CUT_BUFFER, 0, Commands::NumBuffers);
+
+  std::vector<std::thread> producers;
+  for (int t = 0; t < NumThreads; ++t) {
+    producers.emplace_back([&, t] {
+      int seq = 0;
+      const auto post = [&] {
+        const float value = static_cast<float>(t * Stride + seq++);
+        if (commands.post(Commands::SET_CUT_POSITION, 0, value)) {
+          ++posted[t];
+        } else {
+          ++refused[t];
+        }
+      };
+      for (int k = 0; k < FillCommands; ++k) {
+        post();
+      }
+      fillPosted[t] = posted[t];
+      arrive(filled, NumThreads + 1);
+      for (int k = 0; k < RunCommands; ++k) {
+        post();
+        if (k % 64 == 0) {
+          std::this_thread::yield();
+        }
+      }
+      producing.fetch_sub(1);
+    });
+  }
+
+  // the audio thread: nothing until every lane is full, then apply
+  // commands until the producers are done and the lanes are empty
+  arrive(filled, NumThreads + 1);
+  // with every lane full, two calls in one period share its budget, and
+  // leaving commands waiting is counted once
+  int budget = Commands::MaxPerPeriod;
+  commands.handlePending(&recorder, 0, budget);
+  commands.handlePending(&recorder, 0, budget);
+  size_t firstPeriod = 0;
+  for (const auto &s : recorder.seen) {
+    firstPeriod += s.size();
+  }
+  const uint32_t firstDeferred = commands.getDeferred();
+  uint32_t frame = 256;
+  for (;;) {
+    const bool done = producing.load() == 0;
+    int budget = Commands::MaxPerPeriod;
+    commands.handlePending(&recorder, frame, budget);
+    frame += 256;
+    size_t applied = 0;
+    for (const auto &s : recorder.seen) {
+      applied += s.size();
+    }
+    size_t accepted = 0;
+    if (done) {
+      for (int t = 0; t < NumThreads; ++t) {
+        accepted += static_cast<size_t>(posted[t]);
+      }
+      if (applied == accepted) {
+        break;
+      }
+    }
+  }
+  for (auto &p : producers) {
+    p.join();
+  }
+
+  int failures = 0;
+  const auto check = [&](bool ok, const char *what, int t) {
+    if (!ok) {
+      std::fprintf(stderr, "thread %d: %s\n", t, what);
+      ++failures;
+    }
+  };
+  int fillTotal = 0;
+  int fullLanes = 0;
+  uint32_t refusedTotal = 0;
+  for (int t = 0; t < NumThreads; ++t) {
+    fillTotal += fillPosted[t];
+    fullLanes += fillPosted[t] == Commands::LaneCapacity;
+    refusedTotal += static_cast<uint32_t>(refused[t]);
+    const auto &s = recorder.seen[t];
+    check(s.size() == static_cast<size_t>(posted[t]),
+          "applied a different number of commands than were accepted", t);
+    bool ordered = true;
+    for (size_t i = 1; i < s.size(); ++i) {
+      ordered = ordered && s[i] > s[i - 1];
+    }
+    check(ordered, "commands applied out of order", t);
+    check(refused[t] > 0, "lane never overflowed", t);
+  }
+  // before anything was consumed, every lane took exactly its capacity,
+  // and the threads with their own lanes took a whole lane each
+  check(fillTotal == Commands::MaxLanes * Commands::LaneCapacity,
+        "lanes did not fill to capacity", -1);
+  check(fullLanes >= Commands::MaxLanes - 1, "a lane was shared early", -1);
+  check(commands.getDropped() == refusedTotal,
+        "dropped count differs from refused posts", -1);
+  check(recorder.bad == 0, "applied a command nobody posted", -1);
+  check(!invalidPosted, "accepted an index out of range", -1);
+  check(firstPeriod == Commands::MaxPerPeriod && firstDeferred == 1,
+        "a period applied other than MaxPerPeriod commands", -1);
+
+  // a parameter, a queued command, then a parameter again are applied in
+  // that order, though parameters go through the table
+  auto ordered = std::make_unique<Commands>();
+  ordered->post(Commands::SET_LEVEL_CUT, 0, 0.8f);
+  ordered->post(Commands::RESET, 0.f);
+  ordered->post(Commands::SET_CUT_RATE, 0, 2.f);
+  Sequence sequence;
+  int orderedBudget = Commands::MaxPerPeriod;
+  ordered->handlePending(&sequence, 0, orderedBudget);
+  ordered->handleParams(&sequence);
+  const std::vector<Commands::Id> expected = {
+      Commands::SET_LEVEL_CUT, Commands::RESET, Commands::SET_CUT_RATE};
+  check(sequence.ids == expected,
+        "parameters and queued commands applied out of order", -1);
+
+  // threads that come and go give their lanes back: after many have posted
+  // once and exited, as many threads as there are private lanes each get
+  // one, and fill it
+  auto churn = std::make_unique<Commands>();
+  for (int k = 0; k < 4 * Commands::MaxLanes; ++k) {
+    std::thread([&] {
+      churn->post(Commands::SET_CUT_POSITION, 0, 0.f);
+    }).join();
+  }
+  int churnBudget = Commands::MaxLanes * Commands::LaneCapacity;
+  churn->handlePending(&sequence, 0, churnBudget);
+  std::atomic<int> holding{0};
+  std::atomic<int> churnPosted{0};
+  std::vector<std::thread> holders;
+  for (int t = 0; t < Commands::MaxLanes - 1; ++t) {
+    holders.emplace_back([&] {
+      for (int k = 0; k < Commands::LaneCapacity; ++k) {
+        churnPosted += churn->post(Commands::SET_CUT_POSITION, 0, 0.f);
+      }
+      // keep the lane until every holder has filled its own
+      arrive(holding, Commands::MaxLanes - 1);
+    });
+  }
+  for (auto &h : holders) {
+    h.join();
+  }
+  check(churnPosted ==
+            (Commands::MaxLanes - 1) * Commands::LaneCapacity,
+        "exited threads kept their lanes", -1);
+  if (failures > 0) {
+    return 1;
+  }
+  std::printf("ok: %u dropped\n", refusedTotal);
+  return 0;
+}
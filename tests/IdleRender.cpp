@@ -0,0 +1,143 @@
+// renders a session in which voices go idle in every way that softcut
+// skips work for: parked voices, silent input into decayed filters,
+// silent tape fx, settled ramps, and writes at rec level 0 and pre level 1.
+// writes every output block, then both buffers, to the file named by the
+// first argument. built against softcut and softcut_reference, which
+// runs every stage regardless; the files must match
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "softcut/Softcut.h"
+
+using namespace softcut;
+
+namespace {
+
+constexpr int NumVoices = 8;
+constexpr float SampleRate = 48000;
+constexpr int BufFrames = 1 << 20;
+constexpr int BlockFrames = 256;
+constexpr int NumBlocks = 48000 * 8 / BlockFrames;
+
+// deterministic noise in [-0.5, 0.5)
+struct Noise {
+  uint32_t state = 1;
+  sample_t next() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<sample_t>(state >> 8) / (1 << 24) - 0.5;
+  }
+};
+
+int blockAt(float sec) { return static_cast<int>(sec * SampleRate) / BlockFrames; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <output file>\n", argv[0]);
+    return 1;
+  }
+  std::FILE *file = std::fopen(argv[1], "wb");
+  if (file == nullptr) {
+    std::perror(argv[1]);
+    return 1;
+  }
+
+  std::vector<sample_t> buf[2] = {std::vector<sample_t>(BufFrames),
+                                  std::vector<sample_t>(BufFrames)};
+  Noise noise;
+  for (auto &b : buf) {
+    for (auto &x : b) {
+      x = noise.next();
+    }
+  }
+  auto cut = std::make_unique<Softcut<NumVoices>>();
+  cut->setSampleRate(static_cast<unsigned int>(SampleRate));
+  for (int v = 0; v < NumVoices; ++v) {
+    cut->setVoiceBuffer(v, buf[v & 1].data(), BufFrames);
+    cut->setLoopStart(v, 2.f * v);
+    cut->setLoopEnd(v, 2.f * v + 1.5f);
+    cut->setLoopFlag(v, true);
+    cut->cutToPos(v, 2.f * v);
+    // the filters' coefficients depend on the sample rate; set them after it
+    cut->setPreFilterFc(v, 12000.f);
+    cut->setRecLevel(v, 1.f);
+    cut->setPreLevel(v, 0.5f);
+    cut->setPostFilterLp(v, 1.f);
+    cut->setPostFilterDry(v, 0.f);
+    cut->setPostFilterFc(v, 8000.f);
+  }
+  // 0: overdubs throughout
+  cut->setPlayFlag(0, true);
+  cut->setRecFlag(0, true);
+  // 1: overdubs, with writes that change nothing from 2 s to 5 s
+  cut->setPlayFlag(1, true);
+  cut->setRecFlag(1, true);
+  // 2: records only, input goes quiet
+  cut->setRecFlag(2, true);
+  // 3: parked, with bursts of input
+  // 4: plays with a slewed rate, forward then backward
+  cut->setPlayFlag(4, true);
+  cut->setRateSlewTime(4, 0.5f);
+  cut->setRate(4, 2.f);
+  // 5: plays, then stops and lets its filters and tape fx decay
+  cut->setPlayFlag(5, true);
+  cut->setTapeBias(5, 0.5f);
+  // 6: records once, then plays what it recorded
+  cut->setPlayFlag(6, true);
+  cut->setRecOnceFlag(6, true);
+  // 7: never does anything
+
+  std::vector<sample_t> in[NumVoices], out[NumVoices];
+  const sample_t *inPtr[NumVoices];
+  sample_t *outPtr[NumVoices];
+  bool active[NumVoices];
+  for (int v = 0; v < NumVoices; ++v) {
+    in[v].resize(BlockFrames);
+    out[v].resize(BlockFrames);
+    inPtr[v] = in[v].data();
+    outPtr[v] = out[v].data();
+    active[v] = true;
+  }
+
+  for (int b = 0; b < NumBlocks; ++b) {
+    if (b == blockAt(2.f)) {
+      cut->setRecLevel(1, 0.f);
+      cut->setPreLevel(1, 1.f);
+    }
+    if (b == blockAt(3.f)) {
+      cut->setRate(4, -0.5f);
+      cut->setPlayFlag(5, false);
+    }
+    if (b == blockAt(5.f)) {
+      cut->setRecLevel(1, 0.5f);
+      cut->setPreLevel(1, 0.5f);
+    }
+    // input: on for the first second, and for half a second from 4 s
+    const bool loud = b < blockAt(1.f) || (b >= blockAt(4.f) && b < blockAt(4.5f));
+    for (int v = 0; v < NumVoices; ++v) {
+      for (auto &x : in[v]) {
+        x = loud ? noise.next() : 0;
+      }
+    }
+    // alternate between the lane path and the per-voice path
+    if (b & 1) {
+      cut->processBlocks(inPtr, outPtr, active, BlockFrames);
+    } else {
+      for (int v = 0; v < NumVoices; ++v) {
+        cut->processBlock(v, inPtr[v], outPtr[v], BlockFrames);
+      }
+    }
+    for (int v = 0; v < NumVoices; ++v) {
+      std::fwrite(out[v].data(), sizeof(sample_t), BlockFrames, file);
+    }
+  }
+  for (auto &b : buf) {
+    std::fwrite(b.data(), sizeof(sample_t), BufFrames, file);
+  }
+  std::fclose(file);
+  return 0;
+}
@@ -0,0 +1,171 @@
+// records and plays across the ends of small buffers: heads looping over
+// the buffer's end, heads fading out before its start at negative phases,
+// and scrubbing at rates up to +-1000 with every interpolation quality,
+// with and without mip levels. built against softcut_checked, so indices
+// are bounds-checked by assertions; this also checks that nothing is
+// written outside the buffers, that writes wrap to the other end, and
+// that the output stays finite
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "softcut/Mipmap.h"
+#include "softcut/Softcut.h"
+
+using namespace softcut;
+
+namespace {
+
+constexpr int NumVoices = 4;
+constexpr float SampleRate = 48000;
+constexpr int BufFrames = 1 << 16;
+constexpr int BlockFrames = 256;
+constexpr int NumBlocks = 48000 * 2 / BlockFrames;
+constexpr float BufSec = BufFrames / SampleRate;
+
+// deterministic noise in [-0.5, 0.5)
+struct Noise {
+  uint32_t state = 1;
+  sample_t next() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<sample_t>(state >> 8) / (1 << 24) - 0.5;
+  }
+};
+
+// storage with guard frames either side, which must stay untouched
+struct Guarded {
+  static constexpr int GuardFrames = 4096;
+  static constexpr sample_t Sentinel = 1234.5;
+  std::vector<sample_t> v;
+  explicit Guarded(size_t frames)
+      : v(frames + 2 * GuardFrames, static_cast<sample_t>(0)) {
+    std::fill_n(v.begin(), GuardFrames, Sentinel);
+    std::fill_n(v.end() - GuardFrames, GuardFrames, Sentinel);
+  }
+  sample_t *data() { return v.data() + GuardFrames; }
+  size_t frames() const { return v.size() - 2 * GuardFrames; }
+  bool intact() const {
+    for (int i = 0; i < GuardFrames; ++i) {
+      if (v[i] != Sentinel || v[v.size() - 1 - i] != Sentinel) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// frames in [a, b) that are not zero
+int countWritten(const sample_t *buf, int a, int b) {
+  int n = 0;
+  for (int i = a; i < b; ++i) {
+    n += buf[i] != 0;
+  }
+  return n;
+}
+
+int failures = 0;
+
+void check(bool ok, int quality, const char *what) {
+  if (!ok) {
+    std::fprintf(stderr, "quality %d: %s\n", quality, what);
+    ++failures;
+  }
+}
+
+void run(int quality) {
+  std::vector<Guarded> buf(NumVoices, Guarded(BufFrames));
+  Guarded levels(Mipmap::storageFrames(BufFrames));
+  Mipmap mips;
+  mips.setBuffer(buf[3].data(), levels.data(), BufFrames);
+  mips.rebuild();
+
+  auto cut = std::make_unique<Softcut<NumVoices>>();
+  cut->setSampleRate(static_cast<unsigned int>(SampleRate));
+  for (int v = 0; v < NumVoices; ++v) {
+    cut->setVoiceBuffer(v, buf[v].data(), BufFrames);
+    cut->setInterpolation(v, quality);
+    cut->setPreFilterFc(v, 12000.f);
+    cut->setRecLevel(v, 1.f);
+    cut->setPreLevel(v, 0.5f);
+    cut->setFadeTime(v, 0.05f);
+    cut->setPlayFlag(v, true);
+    cut->setRecFlag(v, true);
+    cut->setLoopFlag(v, true);
+  }
+  // 0: loops over the end of the buffer, so writes wrap to its start
+  cut->setLoopStart(0, BufSec * 0.75f);
+  cut->setLoopEnd(0, BufSec * 1.25f);
+  cut->cutToPos(0, BufSec * 0.75f);
+  // 1: runs backwards over the loop start at 0, fading out at negative
+  // phases, which wrap to the end of the buffer
+  cut->setLoopStart(1, 0.f);
+  cut->setLoopEnd(1, BufSec * 0.5f);
+  cut->cutToPos(1, BufSec * 0.25f);
+  cut->setRate(1, -1.f);
+  // 2 and 3: scrub over the whole buffer, 3 with mip levels
+  for (int v = 2; v < NumVoices; ++v) {
+    cut->setLoopStart(v, 0.f);
+    cut->setLoopEnd(v, BufSec);
+  }
+  cut->setVoiceMipmap(3, &mips);
+
+  Noise noise;
+  std::vector<sample_t> in(NumVoices * BlockFrames);
+  std::vector<sample_t> out(NumVoices * BlockFrames);
+  const sample_t *inp[NumVoices];
+  sample_t *outp[NumVoices];
+  const bool active[NumVoices] = {true, true, true, true};
+  for (int v = 0; v < NumVoices; ++v) {
+    inp[v] = in.data() + v * BlockFrames;
+    outp[v] = out.data() + v * BlockFrames;
+  }
+  bool finite = true;
+  for (int b = 0; b < NumBlocks; ++b) {
+    if (b % 8 == 0) {
+      // a gesture: jumps between extreme rates either way, and back
+      static constexpr float rates[] = {1000.f, -1.f,     64.5f, -200.f,
+                                        0.01f,   -1000.f, 2.f,   -0.5f};
+      cut->setRate(2, rates[(b / 8) % 8]);
+      cut->setRate(3, -rates[(b / 8 + 3) % 8]);
+    }
+    for (auto &x : in) {
+      x = noise.next();
+    }
+    cut->processBlocks(inp, outp, active, BlockFrames);
+    for (auto y : out) {
+      finite = finite && std::isfinite(static_cast<double>(y));
+    }
+  }
+
+  check(finite, quality, "output is not finite");
+  for (int v = 0; v < NumVoices; ++v) {
+    check(buf[v].intact(), quality, "written outside a buffer");
+  }
+  check(levels.intact(), quality, "written outside the mip levels");
+  // the buffers were silent; only the wrapped parts of the loops reach these
+  const int quarter = BufFrames / 4;
+  check(countWritten(buf[0].data(), 0, quarter / 2) > quarter / 4, quality,
+        "writes over the end don't wrap to the start");
+  check(countWritten(buf[0].data(), quarter + quarter / 2, 2 * quarter) == 0,
+        quality, "writes over the end go elsewhere");
+  check(countWritten(buf[1].data(), BufFrames - quarter / 8, BufFrames) > 0,
+        quality, "writes before the start don't wrap to the end");
+  check(countWritten(buf[1].data(), 3 * quarter, BufFrames - quarter / 2) == 0,
+        quality, "writes before the start go elsewhere");
+}
+
+}  // namespace
+
+int main() {
+  for (int q = Interpolate::Linear; q <= Interpolate::Sinc; ++q) {
+    run(q);
+  }
+  if (failures > 0) {
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
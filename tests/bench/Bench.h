@@ -0,0 +1,68 @@
+// timing for the benchmarks
+
+#ifndef SOFTCUT_BENCH_H
+#define SOFTCUT_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+
+// a cycle count, where one can be read from user space: the x86 time stamp
+// counter, which ticks at the nominal clock rate. zero elsewhere
+inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Result {
+  double ns;      // per frame
+  double cycles;  // per frame, or 0 without a cycle counter
+};
+
+// best of `reps` calls to `f`, after one call to warm up.
+// each call processes `frames` frames
+template <typename F>
+Result measure(F &&f, long frames, int reps = 5) {
+  using Clock = std::chrono::steady_clock;
+  f();
+  Result best{1e30, 1e30};
+  for (int k = 0; k < reps; ++k) {
+    const auto t0 = Clock::now();
+    const uint64_t c0 = cycles();
+    f();
+    const uint64_t c1 = cycles();
+    const auto t1 = Clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    best.ns = std::min(best.ns, ns / frames);
+    best.cycles = std::min(best.cycles, static_cast<double>(c1 - c0) / frames);
+  }
+  return best;
+}
+
+inline void print(const char *name, const Result &r) {
+  std::printf("%-28s %8.2f ns/frame", name, r.ns);
+  if (r.cycles > 0) {
+    std::printf(" %8.1f cycles/frame", r.cycles);
+  }
+  std::printf("\n");
+}
+
+// keep the compiler from dropping the computation of `x`
+template <typename T>
+inline void keep(const T &x) {
+  asm volatile("" : : "g"(&x) : "memory");
+}
+
+}  // namespace bench
+
+#endif  // SOFTCUT_BENCH_H
@@ -0,0 +1,146 @@
+// quality and cost of each interpolation kernel. quality: a sine is read
+// back at a non-integer rate, and the rest of the output, after fitting the
+// sine it should be, is counted as noise (interpolation error and the
+// images it folds back). cost: reading, and reading while recording
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "softcut/ReadWriteHead.h"
+
+using namespace softcut;
+
+namespace {
+
+constexpr float SampleRate = 48000;
+constexpr int BufFrames = 1 << 22;
+constexpr int BlockFrames = 128;
+constexpr long RunFrames = 48000 * 5;
+constexpr float Rate = 1.37f;
+constexpr float LoopStart = 1;
+constexpr float LoopEnd = 61;
+
+struct Kernel {
+  const char *name;
+  Interpolate::Quality quality;
+};
+
+const Kernel kernels[] = {
+    {"linear", Interpolate::Linear},
+    {"hermite", Interpolate::Hermite},
+    {"6-point", Interpolate::SixPoint},
+    {"sinc", Interpolate::Sinc},
+};
+
+// a head playing through the loop from its start, at a fixed rate and
+// levels
+struct Head {
+  FadeCurves fades;
+  ReadWriteHead rwh;
+  float rate[BlockFrames], pre[BlockFrames], rec[BlockFrames];
+
+  Head(sample_t *buf, Interpolate::Quality q, float preLevel, float recLevel) {
+    fades.init();
+    rwh.init(&fades);
+    rwh.setSampleRate(SampleRate);
+    rwh.setBuffer(buf, BufFrames);
+    rwh.setInterpolation(q);
+    rwh.setLoopStartSeconds(LoopStart);
+    rwh.setLoopEndSeconds(LoopEnd);
+    rwh.setLoopFlag(true);
+    rwh.cutToPos(LoopStart);
+    std::fill_n(rate, BlockFrames, Rate);
+    std::fill_n(pre, BlockFrames, preLevel);
+    std::fill_n(rec, BlockFrames, recLevel);
+  }
+
+  void run(const sample_t *in, sample_t *out, long numFrames, bool write) {
+    for (long i = 0; i < numFrames; i += BlockFrames) {
+      rwh.processBlock(rate, pre, rec, in + i, out + i, BlockFrames, true,
+                       write);
+    }
+  }
+};
+
+// ratio of a sine at `w` radians per frame, fitted to `y` by least squares,
+// to what is left over, in dB
+double snr(const std::vector<sample_t> &y, double w) {
+  double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    const double s = std::sin(w * i), c = std::cos(w * i);
+    ss += s * s;
+    sc += s * c;
+    cc += c * c;
+    ys += y[i] * s;
+    yc += y[i] * c;
+  }
+  const double det = ss * cc - sc * sc;
+  const double a = (ys * cc - yc * sc) / det;
+  const double b = (yc * ss - ys * sc) / det;
+  double sig = 0, err = 0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    const double fit = a * std::sin(w * i) + b * std::cos(w * i);
+    sig += fit * fit;
+    err += (y[i] - fit) * (y[i] - fit);
+  }
+  return 10 * std::log10(sig / err);
+}
+
+// snr of a sine at `freq` (as a fraction of the sample rate), read back
+// with kernel `q`
+double sineSnr(Interpolate::Quality q, double freq) {
+  std::vector<sample_t> buf(BufFrames);
+  for (int i = 0; i < BufFrames; ++i) {
+    buf[i] = static_cast<sample_t>(0.5 * std::sin(2 * M_PI * freq * i));
+  }
+  std::vector<sample_t> in(RunFrames), out(RunFrames);
+  auto head = std::make_unique<Head>(buf.data(), q, 1.f, 0.f);
+  head->run(in.data(), out.data(), RunFrames, false);
+  // past the fade in
+  const std::vector<sample_t> y(out.begin() + RunFrames / 2, out.end());
+  return snr(y, 2 * M_PI * freq * Rate);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("sine read at rate %.2f, snr in dB, by sine frequency:\n",
+              Rate);
+  std::printf("%-10s %10s %10s\n", "", "0.1 fs", "0.25 fs");
+  for (const Kernel &k : kernels) {
+    std::printf("%-10s %10.1f %10.1f\n", k.name, sineSnr(k.quality, 0.1),
+                sineSnr(k.quality, 0.25));
+  }
+
+  std::vector<sample_t> buf(BufFrames);
+  for (auto &x : buf) {
+    x = static_cast<sample_t>(rand()) / RAND_MAX - 0.5;
+  }
+  std::vector<sample_t> in(RunFrames), out(RunFrames);
+  for (auto &x : in) {
+    x = static_cast<sample_t>(rand()) / RAND_MAX - 0.5;
+  }
+  std::printf("\ncost, rate %.2f:\n", Rate);
+  for (const Kernel &k : kernels) {
+    auto play = std::make_unique<Head>(buf.data(), k.quality, 1.f, 0.f);
+    const auto runPlay = [&] {
+      play->run(in.data(), out.data(), RunFrames, false);
+      bench::keep(out[0]);
+    };
+    const std::string name = k.name;
+    bench::print((name + ", play").c_str(), bench::measure(runPlay, RunFrames));
+    auto dub = std::make_unique<Head>(buf.data(), k.quality, 0.5f, 0.5f);
+    const auto runDub = [&] {
+      dub->run(in.data(), out.data(), RunFrames, true);
+      bench::keep(out[0]);
+    };
+    bench::print((name + ", play + rec").c_str(),
+                 bench::measure(runDub, RunFrames));
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+// cost per frame of advancing a looping head and reading the buffer at it,
+// with the position kept as a double (the default build) or in 32.32 fixed
+// point (SOFTCUT_FIXED_PHASE), and how far each drifts from the exact
+// position. both are built here, whatever the library's setting; the
+// library's own numbers come from running the other benchmarks in each
+// configuration
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "softcut/FixedPhase.h"
+#include "softcut/Interpolate.h"
+
+using namespace softcut;
+
+namespace {
+
+constexpr int BufFrames = 1 << 22;
+constexpr long RunFrames = 48000 * 5;
+constexpr double Rate = 1.37;
+constexpr double LoopStart = 48000;
+constexpr double LoopEnd = 48000 * 61;
+
+// whole frames at or below `p`, and the fraction past them
+void split(double p, int &i, sample_t &x) {
+  i = static_cast<int>(p);
+  i -= p < static_cast<double>(i);
+  x = static_cast<sample_t>(p - static_cast<double>(i));
+}
+void split(FixedPhase p, int &i, sample_t &x) {
+  i = p.index();
+  x = p.frac<sample_t>();
+}
+
+template <typename P>
+P toPhase(double x) {
+  return P(x);
+}
+
+// the read loop of a playing subhead: advance, wrap at the loop points,
+// interpolate four points around the position
+template <typename P>
+struct Head {
+  const sample_t *buf;
+  P phase = toPhase<P>(LoopStart);
+  P rate = toPhase<P>(Rate);
+  P start = toPhase<P>(LoopStart);
+  P end = toPhase<P>(LoopEnd);
+  P length = toPhase<P>(LoopEnd - LoopStart);
+
+  void run(sample_t *out, long numFrames) {
+    for (long n = 0; n < numFrames; ++n) {
+      P p = phase + rate;
+      if (p > end) {
+        p = p - length;
+      }
+      phase = p;
+      int i;
+      sample_t x;
+      split(p, i, x);
+      constexpr int mask = BufFrames - 1;
+      out[n] = Interpolate::hermite<sample_t>(
+          x, buf[(i - 1) & mask], buf[i & mask], buf[(i + 1) & mask],
+          buf[(i + 2) & mask]);
+    }
+  }
+};
+
+// distance of each head from the exact position after `frames` frames,
+// without looping
+template <typename P>
+double drift(long frames) {
+  P p = toPhase<P>(LoopStart);
+  const P r = toPhase<P>(Rate);
+  for (long n = 0; n < frames; ++n) {
+    p = p + r;
+  }
+  // the exact sum of the rounded increment, in long double
+  const long double inc = static_cast<phase_t>(r);
+  return std::fabs(static_cast<double>(static_cast<long double>(p) -
+                                       (LoopStart + inc * frames)));
+}
+
+}  // namespace
+
+int main() {
+  std::vector<sample_t> buf(BufFrames);
+  for (auto &x : buf) {
+    x = static_cast<sample_t>(rand()) / RAND_MAX - 0.5;
+  }
+  std::vector<sample_t> out(RunFrames);
+
+  Head<double> d{buf.data()};
+  const auto runDouble = [&] {
+    d.run(out.data(), RunFrames);
+    bench::keep(out[0]);
+  };
+  bench::print("double", bench::measure(runDouble, RunFrames));
+  Head<FixedPhase> f{buf.data()};
+  const auto runFixed = [&] {
+    f.run(out.data(), RunFrames);
+    bench::keep(out[0]);
+  };
+  bench::print("32.32 fixed", bench::measure(runFixed, RunFrames));
+
+  // an hour at 48 khz
+  const long hour = 48000L * 3600;
+  std::printf("\nposition error after an hour at rate %.2f, in frames:\n",
+              Rate);
+  std::printf("  double       %.3g\n", drift<double>(hour));
+  std::printf("  32.32 fixed  %.3g\n", drift<FixedPhase>(hour));
+  return 0;
+}
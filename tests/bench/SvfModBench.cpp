@@ -0,0 +1,104 @@
+// cost per frame of an input filter whose cutoff moves at audio rate, by
+// the way the cutoff is set, and how far the fast paths are from the
+// per-frame tan() reference
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "softcut/Svf.h"
+
+namespace {
+
+constexpr float SampleRate = 48000;
+constexpr int BlockFrames = 128;
+constexpr long RunFrames = 48000 * 5;
+
+// a fresh low-pass filter, as a voice sets up its input filter
+Svf makeFilter() {
+  Svf f;
+  f.setSampleRate(SampleRate);
+  f.setLpMix(1.f);
+  f.setHpMix(0.f);
+  f.setBpMix(0.f);
+  f.setBrMix(0.f);
+  f.setRq(4.f);
+  f.setFc(1000.f);
+  return f;
+}
+
+// level of `x - ref` against `ref`, in dB
+double errorDb(const std::vector<float> &x, const std::vector<float> &ref) {
+  double e = 0, s = 0;
+  for (size_t i = 0; i < x.size(); ++i) {
+    e += (x[i] - ref[i]) * (x[i] - ref[i]);
+    s += ref[i] * ref[i];
+  }
+  return 10 * std::log10(e / s);
+}
+
+}  // namespace
+
+int main() {
+  // white noise through a cutoff swept from 100 hz to 12 khz and back,
+  // twice a second
+  std::vector<float> in(RunFrames), fc(RunFrames);
+  for (long i = 0; i < RunFrames; ++i) {
+    in[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+    const double lfo = 0.5 - 0.5 * std::cos(2 * M_PI * 2 * i / SampleRate);
+    fc[i] = static_cast<float>(100 * std::pow(120.0, lfo));
+  }
+  std::vector<float> ref(RunFrames), out(RunFrames);
+
+  Svf f = makeFilter();
+  const auto perFrame = [&] {
+    for (long i = 0; i < RunFrames; ++i) {
+      f.setFc(fc[i]);
+      ref[i] = f.getNextSample(in[i]);
+    }
+    bench::keep(ref[0]);
+  };
+  bench::print("setFc() per frame", bench::measure(perFrame, RunFrames));
+  // each measured run starts where the last one left off; compare runs
+  // from a fresh filter
+  f = makeFilter();
+  perFrame();
+
+  const auto perFrameFast = [&] {
+    for (long i = 0; i < RunFrames; ++i) {
+      f.setFcFast(fc[i]);
+      out[i] = f.getNextSample(in[i]);
+    }
+    bench::keep(out[0]);
+  };
+  bench::print("setFcFast() per frame", bench::measure(perFrameFast, RunFrames));
+  f = makeFilter();
+  perFrameFast();
+  const double fastDb = errorDb(out, ref);
+
+  const auto mod = [&] {
+    for (long i = 0; i < RunFrames; i += BlockFrames) {
+      f.processMod(in.data() + i, out.data() + i, fc.data() + i, 0.f,
+                   BlockFrames);
+    }
+    bench::keep(out[0]);
+  };
+  bench::print("processMod()", bench::measure(mod, RunFrames));
+  f = makeFilter();
+  mod();
+  const double modDb = errorDb(out, ref);
+
+  const auto fixed = [&] {
+    for (long i = 0; i < RunFrames; i += BlockFrames) {
+      f.process(in.data() + i, out.data() + i, 0.f, BlockFrames);
+    }
+    bench::keep(out[0]);
+  };
+  bench::print("process(), fixed cutoff", bench::measure(fixed, RunFrames));
+
+  std::printf("\nerror against setFc() per frame:\n");
+  std::printf("  setFcFast() per frame %7.1f dB\n", fastDb);
+  std::printf("  processMod()          %7.1f dB\n", modDb);
+  return 0;
+}
@@ -0,0 +1,80 @@
+// cost per frame of one voice in each play/record mode
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "softcut/Voice.h"
+
+using namespace softcut;
+
+namespace {
+
+constexpr float SampleRate = 48000;
+constexpr int BufFrames = 1 << 22;
+constexpr int BlockFrames = 256;
+// per measured call. a loop is long enough that rec-once and one-shot
+// voices are still running after the warmup and every repetition
+constexpr long RunFrames = 48000 * 5;
+constexpr float LoopStart = 1;
+constexpr float LoopEnd = 61;
+
+struct Mode {
+  const char *name;
+  bool play;
+  bool rec;
+  bool recOnce;
+  bool loop;
+};
+
+const Mode modes[] = {
+    {"play, loop", true, false, false, true},
+    {"play, one-shot", true, false, false, false},
+    {"rec, loop", false, true, false, true},
+    {"play + rec, loop", true, true, false, true},
+    {"play + rec, one-shot", true, true, false, false},
+    {"rec once", false, true, true, true},
+    {"play + rec once", true, true, true, true},
+};
+
+}  // namespace
+
+int main() {
+  std::vector<sample_t> buf(BufFrames);
+  std::vector<sample_t> in(BlockFrames);
+  std::vector<sample_t> out(BlockFrames);
+  for (int i = 0; i < BufFrames; ++i) {
+    buf[i] = static_cast<sample_t>(rand()) / RAND_MAX - 0.5;
+  }
+  for (auto &x : in) {
+    x = static_cast<sample_t>(rand()) / RAND_MAX - 0.5;
+  }
+
+  for (const Mode &m : modes) {
+    auto voice = std::make_unique<Voice>();
+    voice->setSampleRate(SampleRate);
+    voice->setBuffer(buf.data(), BufFrames);
+    voice->setLoopStart(LoopStart);
+    voice->setLoopEnd(LoopEnd);
+    voice->setLoopFlag(m.loop);
+    voice->setRate(1.f);
+    voice->setRecLevel(0.5f);
+    voice->setPreLevel(0.5f);
+    // rec-once starts recording at the next loop point
+    voice->cutToPos(m.recOnce ? LoopEnd - 0.05f : LoopStart);
+    voice->setPlayFlag(m.play);
+    voice->setRecFlag(m.rec);
+    if (m.recOnce) {
+      voice->setRecOnceFlag(true);
+    }
+    const auto run = [&] {
+      for (long n = 0; n < RunFrames; n += BlockFrames) {
+        voice->processBlockMono(in.data(), out.data(), BlockFrames);
+        bench::keep(out[0]);
+      }
+    };
+    bench::print(m.name, bench::measure(run, RunFrames));
+  }
+  return 0;
+}